@@ -0,0 +1,94 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __CHANNEL_H__
+#define __CHANNEL_H__
+
+#include "mem_req.h"
+#include "global.h"
+
+#include <atomic>
+
+/***
+ *
+ * @class cross-thread channel (channel_c)
+ *
+ * Single-producer/single-consumer FIFO of time-stamped memory requests.  The
+ * parallel engine uses it to hand requests between components that tick on
+ * different host threads.  Every message carries the cycle in which the
+ * producer sent it, so that the consumer can apply it at exactly the point
+ * where the serial simulator would have.
+ *
+ * Storage grows in fixed-size blocks, so push() never blocks; the time lag
+ * between the two sides (and thus the occupancy) is bounded by the engine.
+ */
+
+struct channel_msg_s {
+  counter    m_cycle;    ///< producer cycle when the message was sent
+  mem_req_s* m_req;      ///< request being transferred
+};
+
+class channel_c {
+public:
+  channel_c() {
+    m_head = m_tail = new block_s();
+    m_head_idx = m_tail_idx = 0;
+  }
+
+  ~channel_c() {
+    while (m_head) {
+      block_s* next = m_head->m_next.load(std::memory_order_relaxed);
+      delete m_head;
+      m_head = next;
+    }
+  }
+
+  /// (producer) append a message
+  void push(counter cycle, mem_req_s* req) {
+    if (m_tail_idx == BLOCK_SIZE) {
+      block_s* block = new block_s();
+      m_tail->m_next.store(block, std::memory_order_release);
+      m_tail = block;
+      m_tail_idx = 0;
+    }
+    m_tail->m_slot[m_tail_idx].m_cycle = cycle;
+    m_tail->m_slot[m_tail_idx].m_req = req;
+    m_tail->m_count.store(++m_tail_idx, std::memory_order_release);
+  }
+
+  /// (consumer) peek at the oldest message; returns false if there is none
+  bool front(channel_msg_s& msg) {
+    if (m_head_idx == BLOCK_SIZE) {
+      block_s* next = m_head->m_next.load(std::memory_order_acquire);
+      if (next == nullptr) return false;
+      delete m_head;
+      m_head = next;
+      m_head_idx = 0;
+    }
+    if (m_head_idx == m_head->m_count.load(std::memory_order_acquire)) return false;
+
+    msg = m_head->m_slot[m_head_idx];
+    return true;
+  }
+
+  /// (consumer) drop the message returned by front()
+  void pop() { ++m_head_idx; }
+
+private:
+  static const unsigned BLOCK_SIZE = 1024;
+
+  struct block_s {
+    block_s() : m_count(0), m_next(nullptr) {}
+    channel_msg_s m_slot[BLOCK_SIZE];
+    std::atomic<unsigned> m_count;       ///< # of published slots
+    std::atomic<block_s*> m_next;        ///< next block (set once this one is full)
+  };
+
+  // keep the two ends on separate host cache lines
+  alignas(64) block_s* m_head;           ///< consumer block
+  unsigned m_head_idx;                   ///< consumer slot
+  alignas(64) block_s* m_tail;           ///< producer block
+  unsigned m_tail_idx;                   ///< producer slot
+};
+
+#endif // !__CHANNEL_H__
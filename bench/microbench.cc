@@ -0,0 +1,247 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ * Microbenchmarks for the hot paths of the simulator.
+ *
+ *  - cache_base_c::access: lookup hit, lookup miss, and fill with eviction
+ *    (fill_2), for several associativities
+ *  - queue_c: push + pop of one request, at several queue depths
+ *  - memory_hierarchy_c: create_mem_req + free_mem_req, and
+ *    is_repeated_miss_req at several in-flight depths
+ *
+ * Every case reports ns/op and heap allocations/op.  Results are written as
+ * one "<case> <param> <ns/op> <allocs/op>" line per case in a fixed order, so
+ * two runs (e.g., before and after a change) can be compared with diff.
+ * Build with the same flags as the simulator.
+ */
+
+#include "memory_system/memory_hierarchy.h"
+#include "cache_base/cache_base.h"
+#include "atom/queue.h"
+#include "config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////
+// allocation counting: every heap allocation in this binary
+///////////////////////////////////////////////////////////////////
+
+static unsigned long long g_num_allocs = 0;
+
+void* operator new(std::size_t size) {
+  ++g_num_allocs;
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+///////////////////////////////////////////////////////////////////
+
+/**
+ *
+ * @class microbench_c
+ *
+ * Benchmark cases (a friend of memory_hierarchy_c for the request path).
+ */
+class microbench_c {
+public:
+  microbench_c(const std::string& config_file, FILE* out);
+
+  void run_all();
+
+private:
+  /// time "ops" operations performed by body(); record ns/op and allocs/op
+  template <typename F>
+  void measure(const std::string& name, int param, long ops, F body);
+
+  void bench_cache_access(int assoc);
+  void bench_queue(int depth);
+  void bench_mem_req();
+  void bench_repeated_miss(int depth);
+
+  std::string m_config_file;
+  FILE* m_out;
+};
+
+namespace {
+const int CACHE_SIZE = 32768;
+const int LINE_SIZE = 64;
+const long NUM_OPS = 1 << 20;
+
+double now() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+}
+
+microbench_c::microbench_c(const std::string& config_file, FILE* out) {
+  m_config_file = config_file;
+  m_out = out;
+}
+
+template <typename F>
+void microbench_c::measure(const std::string& name, int param, long ops, F body) {
+  unsigned long long allocs = g_num_allocs;
+  double start = now();
+  body();
+  double seconds = now() - start;
+  allocs = g_num_allocs - allocs;
+
+  double ns_per_op = seconds * 1e9 / ops;
+  double allocs_per_op = (double)allocs / ops;
+
+  printf("%-24s %6d %12.2f ns/op %8.3f allocs/op\n", name.c_str(), param, ns_per_op, allocs_per_op);
+  fprintf(m_out, "%s %d %.2f %.3f\n", name.c_str(), param, ns_per_op, allocs_per_op);
+  fflush(stdout);
+}
+
+/**
+ * cache_base_c::access on a 32KB cache.  Hits cycle over lines that are
+ * resident; misses look up lines of another region (no fill); fills stream
+ * new lines into full sets, so every fill evicts (fill_2).
+ */
+void microbench_c::bench_cache_access(int assoc) {
+  int num_sets = CACHE_SIZE / (assoc * LINE_SIZE);
+  int num_lines = num_sets * assoc;
+  cache_base_c cache("L1", num_sets, assoc, LINE_SIZE);
+
+  for (int ii = 0; ii < num_lines; ++ii) {
+    cache.access((addr_t)ii * LINE_SIZE, READ, true);
+  }
+
+  measure("access_hit", assoc, NUM_OPS, [&]() {
+    for (long ii = 0; ii < NUM_OPS; ++ii) {
+      cache.access((addr_t)(ii % num_lines) * LINE_SIZE, READ, false);
+    }
+  });
+
+  measure("access_miss", assoc, NUM_OPS, [&]() {
+    for (long ii = 0; ii < NUM_OPS; ++ii) {
+      cache.access((addr_t)CACHE_SIZE + (ii % num_lines) * LINE_SIZE, READ, false);
+    }
+  });
+
+  measure("fill_evict", assoc, NUM_OPS, [&]() {
+    for (long ii = 0; ii < NUM_OPS; ++ii) {
+      cache.access((addr_t)(num_lines + ii) * LINE_SIZE, WRITE, true);
+    }
+  });
+}
+
+/**
+ * queue_c holding "depth" requests: push one at the back and pop the front,
+ * as the caches do every time a request moves between queues.
+ */
+void microbench_c::bench_queue(int depth) {
+  std::vector<mem_req_s> reqs(depth + 1, mem_req_s(0, READ));
+  queue_c queue;
+  for (int ii = 0; ii < depth; ++ii) {
+    queue.push(&reqs[ii]);
+  }
+
+  long ops = NUM_OPS / 4;
+  measure("queue_push_pop", depth, ops, [&]() {
+    for (long ii = 0; ii < ops; ++ii) {
+      queue.push(&reqs[(ii + depth) % (depth + 1)]);
+      queue.pop(queue.m_entry.front());
+    }
+  });
+}
+
+/**
+ * One request through memory_hierarchy_c: create, track as in flight, free.
+ */
+void microbench_c::bench_mem_req() {
+  config_c config(m_config_file);
+  config.set_param("mem_hierarchy", 0);
+  memory_hierarchy_c mm(config);
+
+  long ops = NUM_OPS / 4;
+  measure("create_free_mem_req", 0, ops, [&]() {
+    for (long ii = 0; ii < ops; ++ii) {
+      mem_req_s* req = mm.create_mem_req((addr_t)ii * LINE_SIZE, READ);
+      mm.m_in_flight_reqs.push_back(req);
+      mm.free_mem_req(req);
+    }
+  });
+}
+
+/**
+ * is_repeated_miss_req with "depth" missing requests in flight; the looked-up
+ * address is not among them (the common case, and the full scan).
+ */
+void microbench_c::bench_repeated_miss(int depth) {
+  config_c config(m_config_file);
+  config.set_param("mem_hierarchy", 0);
+  memory_hierarchy_c mm(config);
+
+  for (int ii = 0; ii < depth; ++ii) {
+    mem_req_s* req = mm.create_mem_req((addr_t)ii * LINE_SIZE, READ);
+    req->m_is_miss = true;
+    mm.m_in_flight_reqs.push_back(req);
+  }
+  mem_req_s probe((addr_t)-LINE_SIZE, READ);
+
+  long ops = NUM_OPS / 4;
+  bool found = false;
+  measure("is_repeated_miss_req", depth, ops, [&]() {
+    for (long ii = 0; ii < ops; ++ii) {
+      found = mm.is_repeated_miss_req(&probe) || found;
+    }
+  });
+  if (found) fprintf(stderr, "unexpected hit in is_repeated_miss_req\n");
+
+  while (!mm.m_in_flight_reqs.empty()) {
+    mm.free_mem_req(mm.m_in_flight_reqs.back());
+  }
+}
+
+void microbench_c::run_all() {
+  for (int assoc : {1, 2, 4, 8, 16}) {
+    bench_cache_access(assoc);
+  }
+  for (int depth : {1, 16, 64, 256}) {
+    bench_queue(depth);
+  }
+  bench_mem_req();
+  for (int depth : {1, 16, 64, 256}) {
+    bench_repeated_miss(depth);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    fprintf(stderr, "[Usage]: %s [output file] [config file]\n", argv[0]);
+    return -1;
+  }
+  const char* out_file = (argc >= 2) ? argv[1] : "microbench.txt";
+  const char* config_file = (argc >= 3) ? argv[2] : "configs/memory.cfg";
+
+  FILE* out = fopen(out_file, "w");
+  if (!out) {
+    fprintf(stderr, "cannot open %s\n", out_file);
+    return -1;
+  }
+
+  microbench_c bench(config_file, out);
+  bench.run_all();
+
+  fclose(out);
+  printf("results written to %s\n", out_file);
+  return 0;
+}
@@ -0,0 +1,110 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ * Simulator throughput benchmark.
+ *
+ * Runs every synthetic workload pattern through the standalone tag store
+ * (as run_base does) and through the memory hierarchy at every depth from
+ * mem_hierarchy = 0 up to the depth of the given config, and reports the
+ * host time, simulated accesses per second and simulated cycles per second.
+ * Numbers are only comparable between builds on the same host.
+ */
+
+#include "memory_system/memory_hierarchy.h"
+#include "core/core.h"
+#include "core/workload.h"
+#include "cache_base/cache_base.h"
+#include "config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+const char* pattern_name[] = {"", "seq", "stride", "random", "chase", "stencil", "matmul"};
+
+double now() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const std::string& mode, int pattern, counter accesses, counter cycles, double seconds) {
+  if (cycles) {
+    printf("%-16s %-8s %10llu %10llu %8.3f %12.0f %12.0f\n", mode.c_str(), pattern_name[pattern],
+           (unsigned long long)accesses, (unsigned long long)cycles, seconds,
+           accesses / seconds, cycles / seconds);
+  } else {
+    printf("%-16s %-8s %10llu %10s %8.3f %12.0f %12s\n", mode.c_str(), pattern_name[pattern],
+           (unsigned long long)accesses, "-", seconds, accesses / seconds, "-");
+  }
+  fflush(stdout);
+}
+
+/// standalone tag store with the L1D geometry (run_base)
+void run_base(const config_c& config, const workload_config_s& wc) {
+  cache_config_s cc = config.get_cache_config("l1d");
+  cache_base_c cache("L1", cc.get_num_sets(), cc.assoc, cc.line_size);
+  synthetic_workload_c workload(wc);
+
+  int type;
+  addr_t address;
+  counter accesses = 0;
+
+  double start = now();
+  while (workload.next(type, address)) {
+    if (!cache.access(address, type, false)) {
+      cache.access(address, type, true);
+    }
+    ++accesses;
+  }
+  report("run_base", wc.pattern, accesses, 0, now() - start);
+}
+
+/// full timing simulation with the given number of cache levels
+void run_hierarchy(config_c config, const workload_config_s& wc, int num_levels) {
+  config.set_param("mem_hierarchy", num_levels);
+
+  memory_hierarchy_c* mm = new memory_hierarchy_c(config);
+  core_c* core = new core_c(mm);
+  core->m_show_progress = false;
+  synthetic_workload_c workload(wc);
+
+  double start = now();
+  core->run_sim(&workload);
+  double seconds = now() - start;
+
+  report("mem_hierarchy=" + std::to_string(num_levels), wc.pattern,
+         core->m_num_insts + core->m_num_mem_insts, core->m_cycle, seconds);
+
+  delete mm;
+  delete core;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "[Usage]: %s <config file> [instructions per run]\n", argv[0]);
+    return -1;
+  }
+
+  config_c config(argv[1]);
+  workload_config_s wc = config.get_workload_config();
+  if (argc == 3) wc.num_insts = atoi(argv[2]);
+
+  printf("%-16s %-8s %10s %10s %8s %12s %12s\n", "mode", "workload", "accesses", "cycles",
+         "time(s)", "accesses/s", "cycles/s");
+
+  for (int pattern = WL_SEQUENTIAL; pattern < WL_LAST; ++pattern) {
+    wc.pattern = pattern;
+    run_base(config, wc);
+    for (int num_levels = 0; num_levels <= config.get_num_levels(); ++num_levels) {
+      run_hierarchy(config, wc, num_levels);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,173 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class miss_attribution_c
+ *
+ * Miss attribution by set, page and address range; see attribution.h.
+ */
+
+#include "attribution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iomanip>
+
+///////////////////////////////////////////////////////////////////
+// space_saving_c
+///////////////////////////////////////////////////////////////////
+
+space_saving_c::space_saving_c(int capacity) {
+  assert(capacity > 0);
+  m_capacity = capacity;
+  m_items.reserve(capacity);
+}
+
+void space_saving_c::add(uint64_t key) {
+  auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    ++m_items[it->second].m_count;
+    return;
+  }
+
+  if ((int)m_items.size() < m_capacity) {
+    m_index[key] = m_items.size();
+    m_items.push_back(item_s{key, 1, 0});
+    return;
+  }
+
+  // full: the new key takes over the smallest counter
+  int min_pos = 0;
+  for (int ii = 1; ii < m_capacity; ++ii) {
+    if (m_items[ii].m_count < m_items[min_pos].m_count) min_pos = ii;
+  }
+  item_s& item = m_items[min_pos];
+  m_index.erase(item.m_key);
+  m_index[key] = min_pos;
+  item.m_key = key;
+  item.m_error = item.m_count;
+  ++item.m_count;
+}
+
+void space_saving_c::clear() {
+  m_items.clear();
+  m_index.clear();
+}
+
+std::vector<space_saving_c::item_s> space_saving_c::top(int num) const {
+  std::vector<item_s> items = m_items;
+  std::sort(items.begin(), items.end(), [](const item_s& a, const item_s& b) {
+    return a.m_count != b.m_count ? a.m_count > b.m_count : a.m_key < b.m_key;
+  });
+  if ((int)items.size() > num) items.resize(num);
+  return items;
+}
+
+///////////////////////////////////////////////////////////////////
+// miss_attribution_c
+///////////////////////////////////////////////////////////////////
+
+/**
+ * @param num_sets - number of sets of the cache
+ * @param top_n - number of sets/pages listed in the report
+ * @param page_size - page granularity of the page counts (bytes)
+ */
+miss_attribution_c::miss_attribution_c(int num_sets, int top_n, int page_size)
+    : m_pages(PAGE_SKETCH_SIZE) {
+  assert(top_n > 0 && page_size > 0);
+  m_num_sets = num_sets;
+  m_top_n = std::min(top_n, (int)PAGE_SKETCH_SIZE);
+  m_page_size = page_size;
+
+  m_set_misses.assign(num_sets, 0);
+  m_set_evictions.assign(num_sets, 0);
+  m_num_misses = 0;
+}
+
+bool miss_attribution_c::add_ranges(const std::string& spec) {
+  size_t begin = 0;
+  while (begin < spec.size()) {
+    size_t end = spec.find(',', begin);
+    if (end == std::string::npos) end = spec.size();
+    std::string item = spec.substr(begin, end - begin);
+    begin = end + 1;
+
+    size_t colon = item.find(':');
+    size_t dash = item.find('-', colon);
+    if (colon == std::string::npos || dash == std::string::npos) return false;
+
+    range_s range;
+    range.m_name = item.substr(0, colon);
+    range.m_start = std::strtoull(item.c_str() + colon + 1, nullptr, 0);
+    range.m_end = std::strtoull(item.c_str() + dash + 1, nullptr, 0);
+    range.m_misses = 0;
+    if (range.m_end <= range.m_start) return false;
+    m_ranges.push_back(range);
+  }
+  return true;
+}
+
+void miss_attribution_c::print_report(std::ostream& os, const std::string& name) const {
+  auto percent = [&](uint64_t misses) {
+    return m_num_misses ? (double)misses / m_num_misses * 100 : 0.0;
+  };
+
+  // sets by misses, then by index
+  std::vector<int> sets(m_num_sets);
+  for (int ii = 0; ii < m_num_sets; ++ii) sets[ii] = ii;
+  int num_top = std::min(m_top_n, m_num_sets);
+  std::partial_sort(sets.begin(), sets.begin() + num_top, sets.end(), [&](int a, int b) {
+    return m_set_misses[a] != m_set_misses[b] ? m_set_misses[a] > m_set_misses[b] : a < b;
+  });
+
+  int num_missing_sets = 0;
+  for (int ii = 0; ii < m_num_sets; ++ii) {
+    if (m_set_misses[ii]) ++num_missing_sets;
+  }
+
+  os << "------------------------------" << "\n";
+  os << name << " Miss Attribution" << "\n";
+  os << "------------------------------" << "\n";
+  os << "sets with misses: " << num_missing_sets << " / " << m_num_sets << "\n";
+
+  uint64_t top_misses = 0;
+  os << "top " << num_top << " sets (set: misses, evictions):\n";
+  for (int ii = 0; ii < num_top && m_set_misses[sets[ii]]; ++ii) {
+    int set = sets[ii];
+    top_misses += m_set_misses[set];
+    os << "  " << set << ": " << m_set_misses[set] << ", " << m_set_evictions[set] << "\n";
+  }
+  os << "misses in the top sets: " << percent(top_misses) << " %\n";
+
+  std::vector<space_saving_c::item_s> pages = m_pages.top(m_top_n);
+  os << "top " << pages.size() << " pages (page: misses, overestimate <=):\n";
+  for (const space_saving_c::item_s& page : pages) {
+    os << "  0x" << std::hex << page.m_key * m_page_size << std::dec << ": "
+       << page.m_count << ", " << page.m_error << "\n";
+  }
+
+  if (!m_ranges.empty()) {
+    os << "misses by address range:\n";
+    for (const range_s& range : m_ranges) {
+      os << "  " << range.m_name << " [0x" << std::hex << range.m_start << ", 0x" << range.m_end
+         << std::dec << "): " << range.m_misses << " (" << percent(range.m_misses) << " %)\n";
+    }
+  }
+}
+
+void miss_attribution_c::reset() {
+  m_set_misses.assign(m_num_sets, 0);
+  m_set_evictions.assign(m_num_sets, 0);
+  m_num_misses = 0;
+  m_pages.clear();
+  for (range_s& range : m_ranges) range.m_misses = 0;
+}
+
+void miss_attribution_c::write_csv(std::ostream& os) const {
+  os << "set,misses,evictions\n";
+  for (int ii = 0; ii < m_num_sets; ++ii) {
+    os << ii << "," << m_set_misses[ii] << "," << m_set_evictions[ii] << "\n";
+  }
+}
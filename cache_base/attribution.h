@@ -0,0 +1,94 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __ATTRIBUTION_H__
+#define __ATTRIBUTION_H__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ *
+ * @class space_saving_c
+ *
+ * Space-saving heavy-hitter sketch: tracks at most m_capacity keys.  A new key
+ * that finds the sketch full replaces the key with the smallest count and
+ * inherits that count as its error, so every key whose true count exceeds
+ * (total / capacity) is guaranteed to be in the sketch, and a reported count
+ * overestimates the true one by at most its error.
+ */
+class space_saving_c {
+public:
+  struct item_s {
+    uint64_t m_key;
+    uint64_t m_count;    ///< upper bound of the true count
+    uint64_t m_error;    ///< count - error is a lower bound
+  };
+
+  space_saving_c(int capacity);
+
+  void add(uint64_t key);
+  void clear();                             ///< forget every key
+  std::vector<item_s> top(int num) const;   ///< the num largest counts, largest first
+
+private:
+  int m_capacity;
+  std::vector<item_s> m_items;
+  std::unordered_map<uint64_t, int> m_index;  ///< key -> position in m_items
+};
+
+/**
+ *
+ * @class miss_attribution_c
+ *
+ * Where the misses of a cache come from: per-set miss and eviction counts
+ * (conflict hotspots), the pages with the most misses and the misses of each
+ * user-defined address range.  The page counts live in a fixed-size
+ * space-saving sketch, so memory does not grow with the footprint.
+ */
+class miss_attribution_c {
+public:
+  static const int PAGE_SKETCH_SIZE = 256;   ///< pages tracked by the sketch
+
+  miss_attribution_c(int num_sets, int top_n, int page_size);
+
+  /// "name:start-end,..." (hex or decimal, end exclusive); false on a syntax error
+  bool add_ranges(const std::string& spec);
+
+  void record_miss(uint64_t address, int set_index) {
+    ++m_set_misses[set_index];
+    ++m_num_misses;
+    m_pages.add(address / m_page_size);
+    for (range_s& range : m_ranges) {
+      if (address >= range.m_start && address < range.m_end) ++range.m_misses;
+    }
+  }
+  void record_eviction(int set_index) { ++m_set_evictions[set_index]; }
+  void reset();                             ///< zero every count (end of the warmup)
+
+  void print_report(std::ostream& os, const std::string& name) const;
+  void write_csv(std::ostream& os) const;   ///< one line per set (heatmap)
+
+private:
+  struct range_s {
+    std::string m_name;
+    uint64_t m_start;
+    uint64_t m_end;
+    uint64_t m_misses;
+  };
+
+  int m_num_sets;
+  int m_top_n;                           ///< sets/pages listed in the report
+  uint64_t m_page_size;
+
+  std::vector<uint64_t> m_set_misses;    ///< per-set misses
+  std::vector<uint64_t> m_set_evictions; ///< per-set evictions
+  uint64_t m_num_misses;
+  space_saving_c m_pages;                ///< misses per page (heavy hitters)
+  std::vector<range_s> m_ranges;         ///< user-defined address ranges
+};
+
+#endif // !__ATTRIBUTION_H__
@@ -10,6 +10,7 @@
 
 #include "cache_base.h"
 
+#include <algorithm>
 #include <cmath>
 #include <string>
 #include <cassert>
@@ -31,6 +32,16 @@ cache_set_c::cache_set_c(int assoc) {
 
   for (int i = 0; i < m_assoc; ++i) {
     cache_entry_c* entry = &m_entry[i];
+
+    // initialize tag/valid/dirty bits
+    entry->m_valid = false;
+    entry->m_dirty = false;
+    entry->m_tag   = 0;
+    entry->m_sector_valid = 0;
+    entry->m_sector_dirty = 0;
+    entry->m_inst = false;
+    entry->m_presence = 0;
+
     m_lru_stack.push_back(entry);
   }
 }
@@ -43,10 +54,11 @@ cache_set_c::~cache_set_c() {
 ///////////////////////////////////////////////////////////////////
 // cache_base_c 
 // 
-// <set_list>
-// set0 : cache_set0 [cache_entry00, cache_entry01, ...]
-// set1 : cache_set1 [cache_entry10, cache_entry11, ...]
-// set1 : cache_set2 [cache_entry20, cache_entry21, ...]
+// <set_pages>
+// page0 : set0    : cache_set0 [cache_entry00, cache_entry01, ...]
+//         set1    : cache_set1 [cache_entry10, cache_entry11, ...]
+//         ...
+// page1 : set1024 : ...
 //
 ///////////////////////////////////////////////////////////////////
 
@@ -56,24 +68,54 @@ cache_set_c::~cache_set_c() {
  * @param num_sets - number of sets in a cache
  * @param assoc - number of cache entries in a set
  * @param line_size - cache block (line) size in bytes
+ * @param lazy_sets - allocate each set on first touch instead of up front
+ * @param sample_sets - simulate only 1 of every sample_sets sets (<= 1: all)
  *
  * @note Test Note.
  */
-cache_base_c::cache_base_c(std::string name, int num_sets, int assoc, int line_size) {
+cache_base_c::cache_base_c(std::string name, int num_sets, int assoc, int line_size, bool lazy_sets,
+                           int sample_sets) {
   m_name = name;
   m_num_sets = num_sets;
   m_line_size = line_size;
+  m_assoc = assoc;
 
-  m_set_list = new cache_set_c *[m_num_sets];
-
+  m_lazy_sets = lazy_sets;
+  m_num_allocated_sets = 0;
+  m_num_set_pages = (m_num_sets + SET_PAGE_SIZE - 1) / SET_PAGE_SIZE;
+  m_set_pages = new cache_set_c **[m_num_set_pages]();
+
+  m_sample_sets = sample_sets;
+  m_num_sampled_sets = 0;
+  m_num_unsampled = 0;
+  m_attribution = nullptr;
+  m_classifier = nullptr;
+  m_write_through = false;
+  m_sector_size = line_size;
+  m_num_sector_misses = 0;
+  for (int ss = 0; ss < PART_LAST; ++ss) {
+    m_part_mask[ss] = 0;
+    m_part_accesses[ss] = 0;
+    m_part_hits[ss] = 0;
+  }
+  m_part_interval = 0;
+  m_part_countdown = 0;
+  m_part_stride = 1;
+  m_num_repartitions = 0;
+  m_part_inst_ways_sum = 0;
   for (int ii = 0; ii < m_num_sets; ++ii) {
-    m_set_list[ii] = new cache_set_c(assoc);
+    if (is_sampled_set(ii)) ++m_num_sampled_sets;
+  }
+  assert(m_num_sampled_sets > 0 && "set sampling leaves no set to simulate");
+  if (is_sampling()) {
+    m_set_accesses.assign(m_num_sets, 0);
+    m_set_misses.assign(m_num_sets, 0);
+  }
 
-    // initialize tag/valid/dirty bits
-    for (int jj = 0; jj < assoc; ++jj) {
-      m_set_list[ii]->m_entry[jj].m_valid = false;
-      m_set_list[ii]->m_entry[jj].m_dirty = false;
-      m_set_list[ii]->m_entry[jj].m_tag   = 0;
+  // unsampled sets are never touched
+  if (!m_lazy_sets) {
+    for (int ii = 0; ii < m_num_sets; ++ii) {
+      if (is_sampled_set(ii)) get_set(ii);
     }
   }
 
@@ -87,12 +129,37 @@ cache_base_c::cache_base_c(std::string name, int num_sets, int assoc, int line_s
   m_is_evicted = false;
   m_is_evicted_dirty = false;
   m_evicted_addr = 0;
+  m_evicted_dirty_sectors = 0;
+  m_evicted_presence = 0;
 }
 
 // cache_base_c destructor
 cache_base_c::~cache_base_c() {
-  for (int ii = 0; ii < m_num_sets; ++ii) { delete m_set_list[ii]; }
-  delete[] m_set_list;
+  for (int pp = 0; pp < m_num_set_pages; ++pp) {
+    if (!m_set_pages[pp]) continue;
+    for (int ii = 0; ii < SET_PAGE_SIZE; ++ii) { delete m_set_pages[pp][ii]; }
+    delete[] m_set_pages[pp];
+  }
+  delete[] m_set_pages;
+  if (m_attribution) delete m_attribution;
+  if (m_classifier) delete m_classifier;
+}
+
+/**
+ * Return the set, allocating it (and its page) if it was never touched.
+ */
+cache_set_c* cache_base_c::get_set(int set_index) {
+  cache_set_c**& page = m_set_pages[set_index >> SET_PAGE_BITS];
+  if (!page) {
+    page = new cache_set_c *[SET_PAGE_SIZE]();
+  }
+
+  cache_set_c*& set = page[set_index & (SET_PAGE_SIZE - 1)];
+  if (!set) {
+    set = new cache_set_c(m_assoc);
+    ++m_num_allocated_sets;
+  }
+  return set;
 }
 
 /** 
@@ -130,8 +197,8 @@ cache_base_c::~cache_base_c() {
  *    2-2-1. hit:  never goes into this
  *    2-2-2. miss: fill_2 && dirty -> true
  *  2-3. Write Back
- *    2-3-1. hit:  fill_1 && no LRU usage
- *    2-3-2. miss: never goes into this
+ *    2-3-1. hit:  fill_1 && no LRU usage (write-through: the line stays clean)
+ *    2-3-2. miss: do nothing (return false)
  *  2-4. Check
  *    never goes into this
  * 
@@ -139,6 +206,9 @@ cache_base_c::~cache_base_c() {
  * @param access_type - read (0), write (1), or instruction fetch (2)
  * @param is_fill - if the access is for a cache fill
  * @param return "true" on a hit; "false" otherwise.
+ *
+ * With set sampling, an access to an unsampled set is dropped right away: it
+ * misses and nothing is updated except the count of dropped accesses.
  */
 bool cache_base_c::access(addr_t address, int access_type, bool is_fill) {
   ////////////////////////////////////////////////////////////////////
@@ -148,15 +218,22 @@ bool cache_base_c::access(addr_t address, int access_type, bool is_fill) {
   int tag = address / (m_num_sets * m_line_size);
   int set_index = (address / m_line_size) % m_num_sets;
 
-  cache_set_c* set = m_set_list[set_index];
+  if (!is_sampled_set(set_index)) {
+    if (!is_fill && access_type != CHECK) ++m_num_unsampled;
+    return false;
+  }
 
-  // Check if there is a cache hit
+  // a set that was never touched (lazy_sets) holds no line
+  cache_set_c* set = find_set(set_index);
+
+  // Check if there is a cache hit (tag match and, if sectored, a valid sector)
   bool hit = false;
   int hit_index = -1;
+  uint64_t sector_bit = get_sector_bit(address);
 
-  for (int i = 0; i < set->m_assoc; ++i) {
+  for (int i = 0; set && i < set->m_assoc; ++i) {
     if (set->m_entry[i].m_valid && set->m_entry[i].m_tag == tag) {
-      hit = true;
+      hit = (set->m_entry[i].m_sector_valid & sector_bit) != 0;
       hit_index = i;
       break;
     }
@@ -180,9 +257,12 @@ bool cache_base_c::access(addr_t address, int access_type, bool is_fill) {
     }
     // 1-2. Write
     else if (access_type == WRITE) {
-      // 1-2-1. hit:  dirty -> true
+      // 1-2-1. hit:  dirty -> true (write-through: stays clean)
       if (hit) {
-        set->m_entry[hit_index].m_dirty = true;
+        if (!m_write_through) {
+          set->m_entry[hit_index].m_dirty = true;
+          set->m_entry[hit_index].m_sector_dirty |= sector_bit;
+        }
         set->m_lru_stack.remove(&set->m_entry[hit_index]);
         set->m_lru_stack.push_front(&set->m_entry[hit_index]);
 
@@ -214,10 +294,36 @@ bool cache_base_c::access(addr_t address, int access_type, bool is_fill) {
     if (hit) { m_num_hits++;} 
     else { m_num_misses++; }
     m_num_accesses++;
+    bool sector_miss = !hit && hit_index != -1;
+    if (sector_miss) ++m_num_sector_misses;
+
+    if (is_sampling()) {
+      ++m_set_accesses[set_index];
+      if (!hit) ++m_set_misses[set_index];
+    }
+    if (m_attribution && !hit) {
+      m_attribution->record_miss(address, set_index);
+    }
+    // (a sector miss is not a miss of the line)
+    if (m_classifier && !sector_miss) {
+      m_classifier->lookup(address / m_line_size, hit);
+    }
+    if (is_partitioned()) {
+      int stream = get_stream(access_type);
+      ++m_part_accesses[stream];
+      if (hit) ++m_part_hits[stream];
+      if (m_part_interval > 0) monitor_partition(stream, set_index, tag);
+    }
   }
 
   // 2. Fill O ( Fill Queue )
   else {
+    // eviction info describes this fill only
+    m_is_evicted = false;
+    m_is_evicted_dirty = false;
+    m_evicted_dirty_sectors = 0;
+    m_evicted_presence = 0;
+
     // 2-1. Read(IF)
       // 2-1-1. hit:  never goes into this
       // 2-1-2. miss: fill_2 && dirty -> false
@@ -229,21 +335,36 @@ bool cache_base_c::access(addr_t address, int access_type, bool is_fill) {
       if (hit) {
         // std::cout << "Fill 2 but hit. ERROR " << '\n';
       }
-      if (!hit) {
+      // sector miss: the line is here; fill the sector, no eviction
+      if (!hit && hit_index != -1) {
+        cache_entry_c* entry = &set->m_entry[hit_index];
+        entry->m_sector_valid |= sector_bit;
+        if (access_type == WRITE && !m_write_through) {
+          entry->m_dirty = true;
+          entry->m_sector_dirty |= sector_bit;
+        }
+        set->m_lru_stack.remove(entry);
+        set->m_lru_stack.push_front(entry);
+      }
+      else if (!hit) {
+        if (!set) set = get_set(set_index);
         fill_2(set, access_type, tag, set_index);
+        // the filled entry is the MRU one
+        cache_entry_c* entry = set->m_lru_stack.front();
+        entry->m_sector_valid = sector_bit;
+        entry->m_sector_dirty = entry->m_dirty ? sector_bit : 0;
+        if (m_classifier) m_classifier->fill(address / m_line_size);
       }
     }
     // 2-3. Write Back
     else if (access_type == WRITE_BACK) {
       // 2-3-1. hit:  fill_1 && no LRU usage
-      if (hit) {
+      if (hit && !m_write_through) {
         fill_1(set, hit_index);
+        set->m_entry[hit_index].m_sector_dirty |= sector_bit;
       }
-      // 2-3-2. miss: never goes into this
-      // assert(hit);
-      if (!hit) {
-        std::cout << "WB but hit false, ERROR ERROR ERROR" << '\n';
-      }
+      // 2-3-2. miss: the line left this cache while the write-back was in
+      //         flight (or the cache is not inclusive); the caller passes it on
     }
     else if (access_type == CHECK) {
       // 2-4. Check
@@ -257,19 +378,68 @@ bool cache_base_c::access(addr_t address, int access_type, bool is_fill) {
   return hit;
 }
 
+/**
+ * Look up a block of records and fill the misses: the same as, for each
+ * record in order, access(addr, type, false) and on a miss
+ * access(addr, type, true), with the same stats.  On the host every lookup
+ * chases set directory -> set -> entries, which all miss for a tag store of
+ * many MB; here the set indices are computed up front and those loads are
+ * prefetched one step per stage ahead of the lookup that needs them, so each
+ * stage finds the pointer the previous one brought in.
+ */
+void cache_base_c::access_batch(const access_s* reqs, int num_reqs) {
+  const int DISTANCE = 8;  // records between prefetch stages
+
+  m_batch_sets.resize(num_reqs);
+  for (int ii = 0; ii < num_reqs; ++ii) {
+    m_batch_sets[ii] = (reqs[ii].m_addr / m_line_size) % m_num_sets;
+  }
+
+  for (int ii = 0; ii < num_reqs; ++ii) {
+    if (ii + 3 * DISTANCE < num_reqs) {
+      int set_index = m_batch_sets[ii + 3 * DISTANCE];
+      cache_set_c** page = m_set_pages[set_index >> SET_PAGE_BITS];
+      if (page) __builtin_prefetch(&page[set_index & (SET_PAGE_SIZE - 1)]);
+    }
+    if (ii + 2 * DISTANCE < num_reqs) {
+      cache_set_c* set = find_set(m_batch_sets[ii + 2 * DISTANCE]);
+      if (set) __builtin_prefetch(set);
+    }
+    if (ii + DISTANCE < num_reqs) {
+      cache_set_c* set = find_set(m_batch_sets[ii + DISTANCE]);
+      if (set) {
+        const char* entries = (const char*)set->m_entry;
+        for (size_t off = 0; off < m_assoc * sizeof(cache_entry_c); off += 64) {
+          __builtin_prefetch(entries + off);
+        }
+      }
+    }
+
+    if (!access(reqs[ii].m_addr, reqs[ii].m_type, false)) {
+      access(reqs[ii].m_addr, reqs[ii].m_type, true);
+    }
+  }
+}
+
 void cache_base_c::fill_1(cache_set_c* set, int hit_index) { 
   set->m_entry[hit_index].m_dirty = true;
 }
 
 void cache_base_c::fill_2(cache_set_c* set, int access_type, int tag, int set_index) {
+  // way partitioning: only the ways of the stream may take the line
+  bool partitioned = is_partitioned();
+  uint32_t mask = partitioned ? m_part_mask[get_stream(access_type)] : 0;
+
   for (int i = 0; i < set->m_assoc; ++i) {
     // Found an empty cache entry 
-    if (!set->m_entry[i].m_valid) {
+    if (!set->m_entry[i].m_valid && (!partitioned || (mask >> i & 1))) {
 
       set->m_entry[i].m_valid = true;
       // A write miss allocates a cacheline in the cache with a dirty flag.
-      set->m_entry[i].m_dirty = (access_type == WRITE);
+      set->m_entry[i].m_dirty = (access_type == WRITE && !m_write_through);
       set->m_entry[i].m_tag = tag;
+      set->m_entry[i].m_inst = (access_type == INST_FETCH);
+      set->m_entry[i].m_presence = 0;
 
       // update LRU
       // just filled cache line -> MRU
@@ -284,18 +454,30 @@ void cache_base_c::fill_2(cache_set_c* set, int access_type, int tag, int set_in
   // No empty cache entry found
   // Evict a cache line with LRU policy and fill the new one
   int evict_index = -1;
-  if (set->m_lru_stack.size() > 0) {
+  if (partitioned) {
+    // the least recently used line among the ways of the stream
+    for (auto it = set->m_lru_stack.rbegin(); it != set->m_lru_stack.rend(); ++it) {
+      int way = *it - set->m_entry;
+      if (mask >> way & 1) {
+        evict_index = way;
+        break;
+      }
+    }
+  } else if (set->m_lru_stack.size() > 0) {
     evict_index = set->m_lru_stack.back() - set->m_entry;
   } 
   assert(evict_index != -1);
 
   m_is_evicted = true;
+  if (m_attribution) m_attribution->record_eviction(set_index);
   // m_evicted_tag = set->m_entry[evict_index].m_tag;
   m_evicted_addr = set->m_entry[evict_index].m_tag * (m_num_sets * m_line_size) + set_index * m_line_size;
+  m_evicted_presence = set->m_entry[evict_index].m_presence;
   
   // Evict and Writeback
   if (set->m_entry[evict_index].m_dirty) {
     m_num_writebacks++;
+    m_evicted_dirty_sectors = __builtin_popcountll(set->m_entry[evict_index].m_sector_dirty);
 
     // for Cache Writeback
     m_is_evicted_dirty = true;
@@ -303,14 +485,79 @@ void cache_base_c::fill_2(cache_set_c* set, int access_type, int tag, int set_in
 
   // Fill with new cache block
   set->m_entry[evict_index].m_valid = true;
-  set->m_entry[evict_index].m_dirty = (access_type == WRITE);
+  set->m_entry[evict_index].m_dirty = (access_type == WRITE && !m_write_through);
   set->m_entry[evict_index].m_tag = tag;    
+  set->m_entry[evict_index].m_inst = (access_type == INST_FETCH);
+  set->m_entry[evict_index].m_presence = 0;
 
   // update LRU
-  set->m_lru_stack.pop_back();
+  if (partitioned) {
+    set->m_lru_stack.remove(&set->m_entry[evict_index]);
+  } else {
+    set->m_lru_stack.pop_back();
+  }
   set->m_lru_stack.push_front(&set->m_entry[evict_index]);
 }
 
+/**
+ * Invalidate the line holding the address (no statistics are updated).
+ * @param address - memory address
+ * @param dirty - set to the dirty bit of the invalidated line
+ * @return "true" if the line was present; "false" otherwise.
+ */
+bool cache_base_c::invalidate(addr_t address, bool& dirty) {
+  int tag = address / (m_num_sets * m_line_size);
+  int set_index = (address / m_line_size) % m_num_sets;
+
+  cache_set_c* set = find_set(set_index);
+
+  dirty = false;
+  for (int i = 0; set && i < set->m_assoc; ++i) {
+    if (set->m_entry[i].m_valid && set->m_entry[i].m_tag == tag) {
+      dirty = set->m_entry[i].m_dirty;
+
+      set->m_entry[i].m_valid = false;
+      set->m_entry[i].m_dirty = false;
+      set->m_entry[i].m_tag = 0;
+      set->m_entry[i].m_sector_valid = 0;
+      set->m_entry[i].m_sector_dirty = 0;
+      set->m_entry[i].m_presence = 0;
+
+      // update LRU
+      set->m_lru_stack.remove(&set->m_entry[i]);
+      if (m_classifier) m_classifier->invalidate(address / m_line_size);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * The valid line holding the address, whatever its sectors (no statistics or
+ * LRU update), or nullptr.
+ */
+cache_entry_c* cache_base_c::find_line(addr_t address) {
+  int tag = address / (m_num_sets * m_line_size);
+  int set_index = (address / m_line_size) % m_num_sets;
+
+  cache_set_c* set = find_set(set_index);
+  for (int i = 0; set && i < set->m_assoc; ++i) {
+    if (set->m_entry[i].m_valid && set->m_entry[i].m_tag == tag) {
+      return &set->m_entry[i];
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Bytes that would be written back if the line holding the address left:
+ * the dirty sectors (the whole line if not sectored).
+ */
+int cache_base_c::get_dirty_bytes(addr_t address) {
+  cache_entry_c* entry = find_line(address);
+  return entry ? __builtin_popcountll(entry->m_sector_dirty) * m_sector_size : 0;
+}
+
 /**
  * Print statistics (DO NOT CHANGE)
  */
@@ -325,6 +572,286 @@ void cache_base_c::print_stats() {
   std::cout << "number of writebacks: "  << m_num_writebacks << "\n";
 }
 
+/**
+ * Set sampling: scale the stats of the sampled sets up to the whole cache.
+ * The miss rate is a ratio estimate over the sampled sets (each set is one
+ * sample of accesses and misses); its error bound is the 95% confidence
+ * interval, with the finite population correction for the number of sets.
+ */
+void cache_base_c::print_sampling_stats() {
+  if (!is_sampling()) return;
+
+  double n = m_num_sampled_sets;
+  double scale = m_num_sets / n;
+
+  double accesses = 0, misses = 0;
+  for (int ii = 0; ii < m_num_sets; ++ii) {
+    accesses += m_set_accesses[ii];
+    misses += m_set_misses[ii];
+  }
+  double miss_rate = accesses ? misses / accesses : 0.0;
+
+  double error = 0.0;
+  if (accesses && n > 1) {
+    double ss = 0;
+    for (int ii = 0; ii < m_num_sets; ++ii) {
+      if (!is_sampled_set(ii)) continue;
+      double dd = m_set_misses[ii] - miss_rate * m_set_accesses[ii];
+      ss += dd * dd;
+    }
+    double mean_accesses = accesses / n;
+    double var = (1.0 - n / m_num_sets) / n * ss / (n - 1) / (mean_accesses * mean_accesses);
+    error = 1.96 * std::sqrt(var);
+  }
+
+  std::cout << "------------------------------" << "\n";
+  std::cout << m_name << " Estimated Miss Rate: " << miss_rate * 100 << " % (+/- " << error * 100 << " %, 95% CI) \n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "number of sampled sets: " << m_num_sampled_sets << " / " << m_num_sets << "\n";
+  std::cout << "number of accesses to unsampled sets: " << m_num_unsampled << "\n";
+  std::cout << "estimated number of accesses: " << (long long)(accesses * scale + 0.5) << "\n";
+  std::cout << "estimated number of misses: " << (long long)(misses * scale + 0.5) << "\n";
+}
+
+/**
+ * Add the statistics of another cache of the same geometry, e.g. one that
+ * simulated a disjoint range of the sets (see set_partition_c).
+ */
+void cache_base_c::merge_stats(const cache_base_c& other) {
+  assert(other.m_num_sets == m_num_sets && other.m_sample_sets == m_sample_sets);
+  assert(!other.m_attribution && !other.m_classifier && "cannot merge attribution or classification");
+  assert(!other.is_partitioned() && "cannot merge way partitioning");
+
+  m_num_accesses += other.m_num_accesses;
+  m_num_hits += other.m_num_hits;
+  m_num_misses += other.m_num_misses;
+  m_num_writes += other.m_num_writes;
+  m_num_writebacks += other.m_num_writebacks;
+  m_num_unsampled += other.m_num_unsampled;
+  for (size_t ii = 0; ii < m_set_accesses.size(); ++ii) {
+    m_set_accesses[ii] += other.m_set_accesses[ii];
+    m_set_misses[ii] += other.m_set_misses[ii];
+  }
+}
+
+/**
+ * Zero every statistic (incl. sampling, attribution and classification
+ * counts) without touching the cached lines.
+ */
+void cache_base_c::reset_stats() {
+  m_num_accesses = 0;
+  m_num_hits = 0;
+  m_num_misses = 0;
+  m_num_writes = 0;
+  m_num_writebacks = 0;
+  m_num_sector_misses = 0;
+  m_num_unsampled = 0;
+  std::fill(m_set_accesses.begin(), m_set_accesses.end(), 0);
+  std::fill(m_set_misses.begin(), m_set_misses.end(), 0);
+  if (m_attribution) m_attribution->reset();
+  if (m_classifier) m_classifier->reset_stats();
+  for (int ss = 0; ss < PART_LAST; ++ss) {
+    m_part_accesses[ss] = 0;
+    m_part_hits[ss] = 0;
+  }
+  m_num_repartitions = 0;
+  m_part_inst_ways_sum = 0;
+}
+
+/**
+ * Register the statistics under "<prefix>." (e.g. "l1d.hits").
+ */
+void cache_base_c::register_stats(stats_registry_c& stats, const std::string& prefix) {
+  stats.add_counter(prefix + ".accesses", &m_num_accesses);
+  stats.add_counter(prefix + ".hits", &m_num_hits);
+  stats.add_counter(prefix + ".misses", &m_num_misses);
+  stats.add_counter(prefix + ".writes", &m_num_writes);
+  stats.add_counter(prefix + ".writebacks", &m_num_writebacks);
+  stats.add_ratio(prefix + ".hit_rate", &m_num_hits, &m_num_accesses);
+  stats.add_ratio(prefix + ".miss_rate", &m_num_misses, &m_num_accesses);
+  if (is_sampling()) {
+    stats.add_counter(prefix + ".unsampled_accesses", &m_num_unsampled);
+  }
+  if (m_classifier) {
+    stats.add_counter(prefix + ".misses_compulsory", &m_classifier->m_num_misses[MISS_COMPULSORY]);
+    stats.add_counter(prefix + ".misses_capacity", &m_classifier->m_num_misses[MISS_CAPACITY]);
+    stats.add_counter(prefix + ".misses_conflict", &m_classifier->m_num_misses[MISS_CONFLICT]);
+  }
+  if (is_partitioned()) {
+    stats.add_counter(prefix + ".partition.inst_accesses", &m_part_accesses[PART_INST]);
+    stats.add_counter(prefix + ".partition.inst_hits", &m_part_hits[PART_INST]);
+    stats.add_ratio(prefix + ".partition.inst_hit_rate", &m_part_hits[PART_INST], &m_part_accesses[PART_INST]);
+    stats.add_counter(prefix + ".partition.data_accesses", &m_part_accesses[PART_DATA]);
+    stats.add_counter(prefix + ".partition.data_hits", &m_part_hits[PART_DATA]);
+    stats.add_ratio(prefix + ".partition.data_hit_rate", &m_part_hits[PART_DATA], &m_part_accesses[PART_DATA]);
+    if (m_part_interval > 0) {
+      stats.add_counter(prefix + ".partition.repartitions", &m_num_repartitions);
+      stats.add_ratio(prefix + ".partition.avg_inst_ways", &m_part_inst_ways_sum, &m_num_repartitions);
+    }
+  }
+}
+
+/**
+ * Attribute the misses of this cache to sets, pages and address ranges.
+ * @param top_n - number of sets/pages listed in the report
+ * @param page_size - page granularity in bytes
+ */
+void cache_base_c::enable_attribution(int top_n, int page_size) {
+  assert(m_attribution == nullptr);
+  m_attribution = new miss_attribution_c(m_num_sets, top_n, page_size);
+}
+
+/**
+ * Classify every miss as compulsory, capacity or conflict.  The shadow
+ * fully-associative cache has as many lines as the simulated sets (only the
+ * sampled ones with set sampling).
+ */
+void cache_base_c::enable_miss_classification() {
+  assert(m_classifier == nullptr);
+  m_classifier = new miss_classifier_c(m_num_sampled_sets * m_assoc);
+}
+
+/**
+ * Split every line into line_size / sector_size sectors (at most 64).  Call
+ * before the first access.
+ */
+void cache_base_c::enable_sectors(int sector_size) {
+  assert(m_num_accesses == 0);
+  assert(sector_size > 0 && m_line_size % sector_size == 0 && m_line_size / sector_size <= 64);
+  m_sector_size = sector_size;
+}
+
+/**
+ * Writes update a line but never leave it dirty: the owner sends every write
+ * on to the next level itself.  Call before the first access.
+ */
+void cache_base_c::enable_write_through() {
+  assert(m_num_accesses == 0);
+  m_write_through = true;
+}
+
+/**
+ * Partition the ways between instruction and data lines.  Call before the
+ * first access.
+ * @param inst_mask - ways instruction fetches may fill (bit i: way i)
+ * @param data_mask - ways data accesses may fill
+ * @param interval - demand accesses between utility-based repartitions;
+ *                   0: the masks are fixed
+ */
+void cache_base_c::enable_way_partition(uint32_t inst_mask, uint32_t data_mask, int interval) {
+  assert(m_num_accesses == 0 && m_assoc <= 32);
+  assert(inst_mask && data_mask && interval >= 0);
+  m_part_mask[PART_INST] = inst_mask;
+  m_part_mask[PART_DATA] = data_mask;
+  m_part_interval = interval;
+  m_part_countdown = interval;
+
+  if (interval > 0) {
+    assert(m_assoc >= 2 && !is_sampling());
+    m_part_stride = std::max(1, m_num_sets / PART_MONITORED_SETS);
+    for (int ss = 0; ss < PART_LAST; ++ss) {
+      m_shadow_tags[ss].resize((m_num_sets + m_part_stride - 1) / m_part_stride);
+      m_shadow_hits[ss].assign(m_assoc, 0);
+    }
+  }
+}
+
+/**
+ * Shadow tags of the monitored sets: the stream's own LRU stack of the full
+ * associativity, as if it had the whole set.  A hit at LRU position p would
+ * also hit with any p + 1 or more ways.
+ */
+void cache_base_c::monitor_partition(int stream, int set_index, addr_t tag) {
+  if (set_index % m_part_stride == 0) {
+    std::vector<addr_t>& tags = m_shadow_tags[stream][set_index / m_part_stride];
+    auto it = std::find(tags.begin(), tags.end(), tag);
+    if (it != tags.end()) {
+      ++m_shadow_hits[stream][it - tags.begin()];
+      tags.erase(it);
+    } else if ((int)tags.size() == m_assoc) {
+      tags.pop_back();
+    }
+    tags.insert(tags.begin(), tag);
+  }
+
+  if (--m_part_countdown == 0) repartition();
+}
+
+/**
+ * End of an interval: give the instruction stream the number of ways n that
+ * maximizes inst hits in n ways + data hits in (assoc - n) ways (ties keep
+ * the current split), then halve the shadow hit counts so that older
+ * intervals weigh less.
+ */
+void cache_base_c::repartition() {
+  m_part_countdown = m_part_interval;
+
+  std::vector<uint64_t> inst_hits(m_assoc + 1, 0), data_hits(m_assoc + 1, 0);  // hits in the first n positions
+  for (int pp = 0; pp < m_assoc; ++pp) {
+    inst_hits[pp + 1] = inst_hits[pp] + m_shadow_hits[PART_INST][pp];
+    data_hits[pp + 1] = data_hits[pp] + m_shadow_hits[PART_DATA][pp];
+  }
+
+  int best_ways = __builtin_popcount(m_part_mask[PART_INST]);
+  uint64_t best_hits = inst_hits[best_ways] + data_hits[m_assoc - best_ways];
+  for (int nn = 1; nn < m_assoc; ++nn) {
+    if (inst_hits[nn] + data_hits[m_assoc - nn] > best_hits) {
+      best_hits = inst_hits[nn] + data_hits[m_assoc - nn];
+      best_ways = nn;
+    }
+  }
+
+  uint32_t all_ways = (m_assoc == 32) ? ~0u : (1u << m_assoc) - 1;
+  m_part_mask[PART_INST] = (1u << best_ways) - 1;
+  m_part_mask[PART_DATA] = all_ways & ~m_part_mask[PART_INST];
+
+  for (int ss = 0; ss < PART_LAST; ++ss) {
+    for (uint64_t& hits : m_shadow_hits[ss]) hits /= 2;
+  }
+  ++m_num_repartitions;
+  m_part_inst_ways_sum += best_ways;
+}
+
+/**
+ * Way partitioning report: final masks, demand hit rate of each stream and
+ * the lines each stream holds at the end of the run.
+ */
+void cache_base_c::print_partition_stats() {
+  if (!is_partitioned()) return;
+
+  uint64_t lines[PART_LAST] = {0, 0};
+  for (int ii = 0; ii < m_num_sets; ++ii) {
+    cache_set_c* set = find_set(ii);
+    for (int jj = 0; set && jj < set->m_assoc; ++jj) {
+      if (set->m_entry[jj].m_valid) ++lines[set->m_entry[jj].m_inst ? PART_INST : PART_DATA];
+    }
+  }
+  double capacity = (double)m_num_sampled_sets * m_assoc;
+  const char* names[PART_LAST] = {"instruction", "data"};
+
+  std::cout << "------------------------------" << "\n";
+  std::cout << m_name << " Way Partitioning (" << (m_part_interval > 0 ? "utility-based" : "fixed") << ")\n";
+  std::cout << "------------------------------" << "\n";
+  for (int ss = 0; ss < PART_LAST; ++ss) {
+    std::cout << names[ss] << " ways: 0x" << std::hex << m_part_mask[ss] << std::dec
+              << " (" << __builtin_popcount(m_part_mask[ss]) << ")\n";
+    std::cout << names[ss] << " accesses: " << m_part_accesses[ss] << "\n";
+    std::cout << names[ss] << " hit rate: "
+              << (m_part_accesses[ss] ? (double)m_part_hits[ss] / m_part_accesses[ss] * 100 : 0.0) << " % \n";
+    std::cout << names[ss] << " lines: " << lines[ss] << " (" << lines[ss] / capacity * 100 << " % of the cache)\n";
+  }
+  if (m_part_interval > 0) {
+    std::cout << "number of repartitions: " << m_num_repartitions << "\n";
+    std::cout << "average instruction ways: "
+              << (m_num_repartitions ? (double)m_part_inst_ways_sum / m_num_repartitions : 0.0) << "\n";
+  }
+}
+
+void cache_base_c::dump_attribution() {
+  if (!m_attribution) return;
+  std::ofstream ofs(m_name + ".sets.csv");
+  m_attribution->write_csv(ofs);
+}
 
 /**
  * Dump tag store (for debugging) 
@@ -337,10 +864,20 @@ void cache_base_c::dump_tag_store(bool is_file) {
     os << "------------------------------" << "\n";
 
     for (int ii = 0; ii < m_num_sets; ii++) {
-      for (int jj = 0; jj < m_set_list[0]->m_assoc; jj++) {
-        os << "[" << (int)m_set_list[ii]->m_entry[jj].m_valid << ", ";
-        os << (int)m_set_list[ii]->m_entry[jj].m_dirty << ", ";
-        os << std::setw(10) << std::hex << m_set_list[ii]->m_entry[jj].m_tag << std::dec << "] ";
+      cache_set_c* set = find_set(ii);
+      for (int jj = 0; jj < m_assoc; jj++) {
+        // untouched set: all entries are still invalid
+        cache_entry_c empty;
+        empty.m_valid = false;
+        empty.m_dirty = false;
+        empty.m_tag = 0;
+        empty.m_sector_valid = 0;
+        empty.m_sector_dirty = 0;
+        const cache_entry_c& entry = set ? set->m_entry[jj] : empty;
+
+        os << "[" << (int)entry.m_valid << ", ";
+        os << (int)entry.m_dirty << ", ";
+        os << std::setw(10) << std::hex << entry.m_tag << std::dec << "] ";
       }
       os << "\n";
     }
@@ -7,6 +7,11 @@
 #include <cstdint>
 #include <string>
 #include <list>
+#include <vector>
+
+#include "attribution.h"
+#include "miss_classifier.h"
+#include "stats.h"
 
 typedef enum request_type_enum {
   READ = 0,
@@ -18,6 +23,12 @@ typedef enum request_type_enum {
 
 using addr_t = uint64_t;
 
+/// one record of a batched lookup (see cache_base_c::access_batch)
+struct access_s {
+  addr_t m_addr;
+  int m_type;
+};
+
 ///////////////////////////////////////////////////////////////////
 class cache_entry_c
 {
@@ -26,6 +37,10 @@ public:
   bool   m_valid;    // valid bit for the cacheline
   bool   m_dirty;    // dirty bit 
   addr_t m_tag;      // tag for the line
+  uint64_t m_sector_valid;  // valid bit per sector (bit 0 only: not sectored)
+  uint64_t m_sector_dirty;  // dirty bit per sector
+  bool   m_inst;     // filled by an instruction fetch (way partitioning stats)
+  uint8_t m_presence;  // upper-level caches that may hold (part of) the line (cache_c)
   friend class cache_base_c;
 };
 
@@ -54,39 +69,154 @@ class cache_base_c
 {
 public:
   cache_base_c();
-  cache_base_c(std::string name, int num_set, int assoc, int line_size);
+  cache_base_c(std::string name, int num_set, int assoc, int line_size, bool lazy_sets = false,
+               int sample_sets = 1);
   ~cache_base_c();
 
   friend class cache_c;
 
   bool access(addr_t address, int access_type, bool is_fill);
+  void access_batch(const access_s* reqs, int num_reqs);  // lookup + fill on a miss, record by record
   void fill_1(cache_set_c* set, int hit_index);
   void fill_2(cache_set_c* set, int access_type, int tag, int set_index);
+  bool invalidate(addr_t address, bool& dirty);  // drop a line; true if it was present
+  cache_entry_c* find_line(addr_t address);  // valid line with the address's tag (any sector), or nullptr
   void print_stats();
+  void print_sampling_stats();  // estimated full-cache stats (set sampling only)
+  void merge_stats(const cache_base_c& other);  // add the stats of a cache of the same geometry
+  void reset_stats();  // zero the stats, keep the contents (end of the warmup)
+  void register_stats(stats_registry_c& stats, const std::string& prefix);
+  void enable_attribution(int top_n, int page_size);  // per-set/page/range miss attribution
+  miss_attribution_c* get_attribution() { return m_attribution; }
+  void dump_attribution();  // per-set misses/evictions to "<name>.sets.csv"
+  void enable_miss_classification();  // three-C (compulsory/capacity/conflict) classification
+  void enable_sectors(int sector_size);  // sectored lines (see below)
+  void enable_write_through();  // writes never dirty a line (the owner passes them on)
+  void enable_way_partition(uint32_t inst_mask, uint32_t data_mask, int interval);  // (see below)
+  void print_partition_stats();  // per-stream accesses, hit rate and occupancy (way partitioning only)
+  miss_classifier_c* get_miss_classifier() { return m_classifier; }
   void dump_tag_store(bool is_file);  // false: dump to stdout, true: dump to a file
 
   bool get_is_evicted() { return m_is_evicted; }
   bool get_is_evicted_dirty() { return m_is_evicted_dirty; }
   addr_t get_evicted_addr() { return m_evicted_addr; }
+  int get_evicted_dirty_bytes() { return m_evicted_dirty_sectors * m_sector_size; }
+  int get_evicted_presence() { return m_evicted_presence; }
+  int get_dirty_bytes(addr_t address);  // dirty bytes of the line holding address (0: not here)
   int m_num_sets;         // number of sets
   int m_line_size;        // cache line size
-
-  cache_set_c **m_set_list;    // cache data structure
+  int m_assoc;            // number of cache blocks in a set
+
+  // set directory (see below)
+  cache_set_c* find_set(int set_index) const {  // nullptr if never touched
+    cache_set_c** page = m_set_pages[set_index >> SET_PAGE_BITS];
+    return page ? page[set_index & (SET_PAGE_SIZE - 1)] : nullptr;
+  }
+  cache_set_c* get_set(int set_index);  // allocate on first touch
+  bool is_lazy() const { return m_lazy_sets; }
+  int get_num_allocated_sets() const { return m_num_allocated_sets; }
+
+  // set sampling (see below)
+  bool is_sampling() const { return m_sample_sets > 1; }
+  bool is_sampled_set(int set_index) const {
+    return m_sample_sets <= 1 || ((uint32_t)set_index * 2654435761u >> 16) % m_sample_sets == 0;
+  }
+  bool is_sampled(addr_t address) const {
+    return is_sampled_set((address / m_line_size) % m_num_sets);
+  }
+
+  // sectored lines (see below)
+  bool is_sectored() const { return m_sector_size < m_line_size; }
+  int get_fetch_size() const { return m_sector_size; }  // bytes a miss brings in
+  uint64_t get_num_sector_misses() const { return m_num_sector_misses; }
+
+  bool is_write_through() const { return m_write_through; }
+
+  // way partitioning (see below)
+  bool is_partitioned() const { return m_part_mask[PART_INST] != 0; }
 
 private:
+  // cache data structure: the sets live in pages of SET_PAGE_SIZE set
+  // pointers.  Normally every set is allocated up front; with lazy_sets a
+  // page and a set are only allocated when a line is first filled there,
+  // so memory follows the touched footprint instead of the capacity.
+  static const int SET_PAGE_BITS = 10;
+  static const int SET_PAGE_SIZE = 1 << SET_PAGE_BITS;
+
+  cache_set_c ***m_set_pages;  // page directory
+  int m_num_set_pages;         // number of pages in the directory
+  bool m_lazy_sets;            // allocate sets on first touch
+  int m_num_allocated_sets;    // number of sets allocated so far
+
+  // set sampling: only the sets picked by a hash of the index (1 of every
+  // m_sample_sets) are simulated; accesses to the others are dropped before
+  // the tag lookup and the stats of the sampled sets are scaled up
+  int m_sample_sets;              // sampling ratio; <= 1: every set
+  int m_num_sampled_sets;         // number of simulated sets
+  uint64_t m_num_unsampled;       // accesses dropped (unsampled sets)
+  std::vector<uint64_t> m_set_accesses;  // per-set accesses (sampled sets)
+  std::vector<uint64_t> m_set_misses;    // per-set misses (sampled sets)
+
+  // access_batch: set index of each record of the batch
+  std::vector<int> m_batch_sets;
+
+  // sectored lines: one tag per line, but valid and dirty bits per sector.
+  // A miss fills only the sector it needs; a lookup whose tag matches but
+  // whose sector is invalid is a sector miss (a miss without an eviction),
+  // and an eviction writes back only the dirty sectors.  Without sectoring
+  // the whole line is one sector.
+  int m_sector_size;              // bytes per sector (== m_line_size: not sectored)
+  uint64_t m_num_sector_misses;   // misses whose tag was present
+
+  uint64_t get_sector_bit(addr_t address) const {
+    return 1ull << ((address % m_line_size) / m_sector_size);
+  }
+
+  // way partitioning between the instruction and the data stream: a fill
+  // may only replace a way of its stream's mask, while lookups search every
+  // way.  The masks are either fixed or, with an interval, utility-based:
+  // each stream keeps shadow LRU tags of the full associativity for a
+  // sample of the sets and counts its hits per LRU position, and every
+  // interval accesses the split with the most hits of both streams is
+  // chosen (the instruction stream takes the low ways).  A line left in a
+  // way that changed stream stays until it is replaced.
+  enum { PART_INST = 0, PART_DATA, PART_LAST };
+  static const int PART_MONITORED_SETS = 32;  // sets with shadow tags
+
+  static int get_stream(int access_type) { return access_type == INST_FETCH ? PART_INST : PART_DATA; }
+  void monitor_partition(int stream, int set_index, addr_t tag);  // shadow tags of a demand access
+  void repartition();
+
+  uint32_t m_part_mask[PART_LAST];        // ways each stream may replace (0: not partitioned)
+  int m_part_interval;                    // accesses between repartitions (0: fixed masks)
+  int m_part_countdown;                   // accesses until the next repartition
+  int m_part_stride;                      // every m_part_stride-th set has shadow tags
+  std::vector<std::vector<addr_t>> m_shadow_tags[PART_LAST];  // per monitored set, MRU first
+  std::vector<uint64_t> m_shadow_hits[PART_LAST];             // shadow hits per LRU position
+  uint64_t m_part_accesses[PART_LAST];    // demand accesses per stream
+  uint64_t m_part_hits[PART_LAST];        // demand hits per stream
+  uint64_t m_num_repartitions;            // intervals ended
+  uint64_t m_part_inst_ways_sum;          // instruction ways summed over the intervals
+
+  miss_attribution_c* m_attribution;  // miss attribution (nullptr if disabled)
+  miss_classifier_c* m_classifier;    // three-C classification (nullptr if disabled)
+  bool m_write_through;              // writes leave lines clean (write-through)
+
   std::string m_name;     // cache name
 
 
   // cache statistics
-  int m_num_accesses; // everytime
-  int m_num_hits; // read, write, IF
-  int m_num_misses; // read, write, IF
-  int m_num_writes; // write access
-  int m_num_writebacks; // write miss && dirty
+  uint64_t m_num_accesses; // everytime
+  uint64_t m_num_hits; // read, write, IF
+  uint64_t m_num_misses; // read, write, IF
+  uint64_t m_num_writes; // write access
+  uint64_t m_num_writebacks; // write miss && dirty
 
   // for evicted cache line
   bool m_is_evicted_dirty;
   addr_t m_evicted_addr;
+  int m_evicted_dirty_sectors;
+  int m_evicted_presence;
 
   // for back inv
   bool m_is_evicted;
@@ -0,0 +1,110 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class miss_classifier_c
+ *
+ * Three-C (compulsory / capacity / conflict) miss classification; see
+ * miss_classifier.h.
+ */
+
+#include "miss_classifier.h"
+
+#include <cassert>
+
+miss_classifier_c::miss_classifier_c(int num_lines) {
+  assert(num_lines > 0);
+  m_num_lines = num_lines;
+  m_index.reserve(num_lines);
+
+  for (int ii = 0; ii < MISS_CLASS_LAST; ++ii) m_num_misses[ii] = 0;
+  m_num_fa_only_misses = 0;
+}
+
+bool miss_classifier_c::first_touch(uint64_t line) {
+  std::vector<uint64_t>& chunk = m_seen[line >> CHUNK_BITS];
+  if (chunk.empty()) chunk.assign((1 << CHUNK_BITS) / 64, 0);
+
+  uint64_t offset = line & ((1 << CHUNK_BITS) - 1);
+  uint64_t& word = chunk[offset / 64];
+  uint64_t bit = (uint64_t)1 << (offset % 64);
+  bool first = !(word & bit);
+  word |= bit;
+  return first;
+}
+
+/**
+ * @param line - line address (address / line size)
+ * @param hit - the lookup hit in the real cache
+ * @return the class of the miss; MISS_CLASS_LAST on a hit
+ */
+int miss_classifier_c::lookup(uint64_t line, bool hit) {
+  auto it = m_index.find(line);
+  bool fa_hit = (it != m_index.end());
+  if (fa_hit) {
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+  }
+
+  if (hit) {
+    // the shadow cache would have fetched the line now
+    if (!fa_hit) {
+      ++m_num_fa_only_misses;
+      fill(line);
+    }
+    return MISS_CLASS_LAST;
+  }
+
+  int miss_class;
+  if (first_touch(line)) {
+    miss_class = MISS_COMPULSORY;
+  } else if (!fa_hit) {
+    miss_class = MISS_CAPACITY;
+  } else {
+    miss_class = MISS_CONFLICT;
+  }
+  ++m_num_misses[miss_class];
+  return miss_class;
+}
+
+void miss_classifier_c::fill(uint64_t line) {
+  auto it = m_index.find(line);
+  if (it != m_index.end()) {
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return;
+  }
+
+  if ((int)m_lru.size() == m_num_lines) {
+    m_index.erase(m_lru.back());
+    m_lru.pop_back();
+  }
+  m_lru.push_front(line);
+  m_index[line] = m_lru.begin();
+}
+
+void miss_classifier_c::invalidate(uint64_t line) {
+  auto it = m_index.find(line);
+  if (it != m_index.end()) {
+    m_lru.erase(it->second);
+    m_index.erase(it);
+  }
+}
+
+void miss_classifier_c::reset_stats() {
+  for (int ii = 0; ii < MISS_CLASS_LAST; ++ii) m_num_misses[ii] = 0;
+  m_num_fa_only_misses = 0;
+}
+
+void miss_classifier_c::print_stats(std::ostream& os, const std::string& name) const {
+  uint64_t total = 0;
+  for (int ii = 0; ii < MISS_CLASS_LAST; ++ii) total += m_num_misses[ii];
+  auto percent = [&](uint64_t misses) { return total ? (double)misses / total * 100 : 0.0; };
+
+  os << "------------------------------" << "\n";
+  os << name << " Miss Classification" << "\n";
+  os << "------------------------------" << "\n";
+  os << "compulsory misses: " << m_num_misses[MISS_COMPULSORY] << " (" << percent(m_num_misses[MISS_COMPULSORY]) << " %)\n";
+  os << "capacity misses: " << m_num_misses[MISS_CAPACITY] << " (" << percent(m_num_misses[MISS_CAPACITY]) << " %)\n";
+  os << "conflict misses: " << m_num_misses[MISS_CONFLICT] << " (" << percent(m_num_misses[MISS_CONFLICT]) << " %)\n";
+  os << "hits that miss fully-associative: " << m_num_fa_only_misses << "\n";
+}
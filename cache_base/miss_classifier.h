@@ -0,0 +1,60 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __MISS_CLASSIFIER_H__
+#define __MISS_CLASSIFIER_H__
+
+#include <cstdint>
+#include <list>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// three-C class of a miss
+enum MISS_CLASS {
+  MISS_COMPULSORY = 0,   ///< first access to the line
+  MISS_CAPACITY,         ///< also misses in a fully-associative LRU cache of the same size
+  MISS_CONFLICT,         ///< hits in that fully-associative cache
+  MISS_CLASS_LAST
+};
+
+/**
+ *
+ * @class miss_classifier_c
+ *
+ * Three-C miss classification.  The lookups, fills and invalidations of the
+ * cache are mirrored on a shadow fully-associative LRU cache with the same
+ * number of lines (a list plus a hash index: O(1) each), so a line arrives in
+ * both at the same time even when the fill comes many cycles after the miss.
+ * Lines that were ever referenced are kept in a bitmap of 4096-line chunks.
+ */
+class miss_classifier_c {
+public:
+  miss_classifier_c(int num_lines);
+
+  /// one lookup of line (line address) in the real cache; returns the MISS_CLASS of a miss
+  int lookup(uint64_t line, bool hit);
+  void fill(uint64_t line);         ///< the line is installed in the real cache
+  void invalidate(uint64_t line);   ///< the line is removed from the real cache
+
+  uint64_t m_num_misses[MISS_CLASS_LAST];   ///< misses per class
+  uint64_t m_num_fa_only_misses;            ///< hits that miss in the shadow cache (LRU anomaly)
+
+  void print_stats(std::ostream& os, const std::string& name) const;
+  void reset_stats();                       ///< zero the counts; lines already seen stay seen
+
+private:
+  bool first_touch(uint64_t line);          ///< mark the line as seen; true if it was not
+
+  static const int CHUNK_BITS = 12;         ///< lines per bitmap chunk: 4096
+
+  // shadow fully-associative cache; MRU: front
+  int m_num_lines;
+  std::list<uint64_t> m_lru;
+  std::unordered_map<uint64_t, std::list<uint64_t>::iterator> m_index;
+
+  std::unordered_map<uint64_t, std::vector<uint64_t>> m_seen;  ///< chunk -> bitmap
+};
+
+#endif // !__MISS_CLASSIFIER_H__
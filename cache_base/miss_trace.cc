@@ -0,0 +1,142 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ * Miss-stream trace writer and reader; see miss_trace.h.
+ */
+
+#include "miss_trace.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace {
+const char MAGIC[4] = {'M', 'S', 'T', 'R'};
+
+void put_u32(FILE* file, uint32_t value) {
+  for (int ii = 0; ii < 4; ++ii) fputc((value >> (8 * ii)) & 0xff, file);
+}
+
+bool get_u32(FILE* file, uint32_t& value) {
+  value = 0;
+  for (int ii = 0; ii < 4; ++ii) {
+    int c = fgetc(file);
+    if (c == EOF) return false;
+    value |= (uint32_t)c << (8 * ii);
+  }
+  return true;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+miss_trace_writer_c::miss_trace_writer_c(const std::string& name, int line_size) {
+  m_file = fopen(name.c_str(), "wb");
+  m_line_size = line_size;
+  m_last_insts = 0;
+  m_last_line = 0;
+  m_num_records = 0;
+  m_num_bytes = 0;
+
+  if (m_file) {
+    fwrite(MAGIC, 1, sizeof(MAGIC), m_file);
+    put_u32(m_file, MISS_TRACE_VERSION);
+    put_u32(m_file, line_size);
+    m_num_bytes = sizeof(MAGIC) + 8;
+  }
+}
+
+miss_trace_writer_c::~miss_trace_writer_c() {
+  if (m_file) close(m_last_insts);
+}
+
+void miss_trace_writer_c::put_varint(uint64_t value) {
+  while (value >= 0x80) {
+    fputc((value & 0x7f) | 0x80, m_file);
+    value >>= 7;
+    ++m_num_bytes;
+  }
+  fputc(value, m_file);
+  ++m_num_bytes;
+}
+
+/**
+ * @param num_insts - instructions fetched so far (never decreases)
+ * @param type - request_type of the request sent to the next level
+ * @param address - memory address (only its line is kept)
+ */
+void miss_trace_writer_c::write(uint64_t num_insts, int type, uint64_t address) {
+  assert(m_file && num_insts >= m_last_insts && type >= 0 && type < MISS_TRACE_END);
+
+  uint64_t line = address / m_line_size;
+  int64_t delta = (int64_t)(line - m_last_line);
+  put_varint((num_insts - m_last_insts) << 3 | type);
+  put_varint((uint64_t)(delta << 1) ^ (uint64_t)(delta >> 63));  // zigzag: small |delta|, few bytes
+
+  m_last_insts = num_insts;
+  m_last_line = line;
+  ++m_num_records;
+}
+
+void miss_trace_writer_c::close(uint64_t num_insts) {
+  assert(m_file && num_insts >= m_last_insts);
+  put_varint((num_insts - m_last_insts) << 3 | MISS_TRACE_END);
+  m_last_insts = num_insts;
+  fclose(m_file);
+  m_file = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+miss_trace_reader_c::miss_trace_reader_c(const std::string& name) {
+  m_file = fopen(name.c_str(), "rb");
+  m_line_size = 0;
+  m_last_insts = 0;
+  m_last_line = 0;
+
+  if (!m_file) return;
+
+  char magic[sizeof(MAGIC)];
+  uint32_t version, line_size;
+  if (fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) ||
+      !get_u32(m_file, version) || version != MISS_TRACE_VERSION || !get_u32(m_file, line_size) ||
+      line_size == 0) {
+    fclose(m_file);
+    m_file = nullptr;
+    return;
+  }
+  m_line_size = line_size;
+}
+
+miss_trace_reader_c::~miss_trace_reader_c() {
+  if (m_file) fclose(m_file);
+}
+
+bool miss_trace_reader_c::get_varint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = fgetc(m_file);
+    if (c == EOF) return false;
+    value |= (uint64_t)(c & 0x7f) << shift;
+    if (!(c & 0x80)) return true;
+  }
+  return false;
+}
+
+/**
+ * Next record.  A trace cut short (no end record) ends at the last complete
+ * record.
+ */
+bool miss_trace_reader_c::read(uint64_t& num_insts, int& type, uint64_t& address) {
+  uint64_t head, zigzag;
+  if (!m_file || !get_varint(head)) return false;
+
+  m_last_insts += head >> 3;
+  type = head & 7;
+  if (type == MISS_TRACE_END || !get_varint(zigzag)) return false;
+
+  int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+  m_last_line += delta;
+
+  num_insts = m_last_insts;
+  address = m_last_line * m_line_size;
+  return true;
+}
@@ -0,0 +1,80 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __MISS_TRACE_H__
+#define __MISS_TRACE_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * Miss-stream trace: the requests one cache sends to the next level (misses
+ * and dirty write-backs), each stamped with the number of instructions
+ * fetched so far.  A sweep of the lower levels replays it instead of the
+ * full trace, most of which the upper level filters out.
+ *
+ * File layout (little endian):
+ *   header:  "MSTR", uint32 version, uint32 line size
+ *   record:  varint((instruction delta << 3) | type), zigzag varint(line delta)
+ *   end:     varint((instruction delta << 3) | MISS_TRACE_END)
+ * The type is a request_type (READ, WRITE, INST_FETCH or WRITE_BACK), the
+ * deltas are against the previous record and a line is an address divided
+ * by the line size.  The end record carries the total instruction count.
+ */
+const int MISS_TRACE_VERSION = 1;
+const int MISS_TRACE_END = 7;
+
+/**
+ *
+ * @class miss_trace_writer_c
+ *
+ * Writes a miss-stream trace.
+ */
+class miss_trace_writer_c {
+public:
+  miss_trace_writer_c(const std::string& name, int line_size);
+  ~miss_trace_writer_c();  // closes the trace if close() was not called
+
+  bool is_open() const { return m_file != nullptr; }
+  void write(uint64_t num_insts, int type, uint64_t address);
+  void close(uint64_t num_insts);  // end record; num_insts: total instruction count
+
+  uint64_t m_num_records;  // records written (without the end record)
+  uint64_t m_num_bytes;    // file size
+
+private:
+  void put_varint(uint64_t value);
+
+  FILE* m_file;
+  int m_line_size;
+  uint64_t m_last_insts;   // instruction count of the previous record
+  uint64_t m_last_line;    // line of the previous record
+};
+
+/**
+ *
+ * @class miss_trace_reader_c
+ *
+ * Reads a miss-stream trace back.
+ */
+class miss_trace_reader_c {
+public:
+  miss_trace_reader_c(const std::string& name);
+  ~miss_trace_reader_c();
+
+  bool is_open() const { return m_file != nullptr; }  // false: missing file or not a miss trace
+  bool read(uint64_t& num_insts, int& type, uint64_t& address);  // false at the end
+  int get_line_size() const { return m_line_size; }
+  uint64_t get_num_insts() const { return m_last_insts; }  // total, once read() returned false
+
+private:
+  bool get_varint(uint64_t& value);
+
+  FILE* m_file;
+  int m_line_size;
+  uint64_t m_last_insts;
+  uint64_t m_last_line;
+};
+
+#endif // !__MISS_TRACE_H__
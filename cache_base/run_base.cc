@@ -2,37 +2,134 @@
 // Lab 4: Memory System Simulation
 
 #include "cache_base.h"
+#include "miss_trace.h"
+#include "set_partition.h"
 
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+
+/**
+ * Look up one request; on a miss, allocate the line.  The misses and dirty
+ * write-backs that go to the next level are appended to the miss trace.
+ */
+void access(cache_base_c* cache, uint64_t num_insts, int type, addr_t address,
+            miss_trace_writer_c* miss_trace) {
+  if (cache->access(address, type, false)) return;
+
+  if (miss_trace) miss_trace->write(num_insts, type, address);
+  cache->access(address, type, true);
+  if (miss_trace && cache->get_is_evicted_dirty()) {
+    miss_trace->write(num_insts, WRITE_BACK, cache->get_evicted_addr());
+  }
+}
 
 /**
  * This function opens a trace file and feeds the trace to your cache
  * @param cache - cache instance to process the trace 
  * @param name - trace file name
+ * @param miss_trace - where to write the miss stream (nullptr: nowhere)
+ * @param partition - worker threads that simulate the cache instead (nullptr: none)
+ * @return the number of instructions (instruction fetches) in the trace
+ *
+ * Without a miss trace the records go to the cache in batches (see
+ * cache_base_c::access_batch); the miss trace needs the eviction of every
+ * fill, so it takes them one at a time.
  */
-void process_trace(cache_base_c* cache, const char* name) {
+uint64_t process_trace(cache_base_c* cache, const char* name, miss_trace_writer_c* miss_trace,
+                       set_partition_c* partition) {
+  const int BATCH_SIZE = 1024;
+
   std::ifstream trace_file(name);
   std::string line;
 
   int type;
   addr_t address;
+  uint64_t num_insts = 0;
+  std::vector<access_s> batch;
+  batch.reserve(BATCH_SIZE);
 
   if (trace_file.is_open()) {
     while (std::getline(trace_file, line)) {
       std::sscanf(line.c_str(), "%d %lx", &type, &address);
-        cache->access(address, type, 1);
+      if (type == INST_FETCH) ++num_insts;
+      if (miss_trace) {
+        access(cache, num_insts, type, address, miss_trace);
+        continue;
+      }
+      if (partition) {
+        partition->access(address, type);
+        continue;
+      }
+
+      access_s req = {address, type};
+      batch.push_back(req);
+      if ((int)batch.size() == BATCH_SIZE) {
+        cache->access_batch(batch.data(), batch.size());
+        batch.clear();
+      }
+    }
+    cache->access_batch(batch.data(), batch.size());
+  }
+  return num_insts;
+}
+
+/**
+ * Replay a miss trace of the level above into the cache, as its next level:
+ * a write miss above is a read here (the data comes back dirty later, with
+ * the write-back), and a write-back that misses here is passed on.
+ * @return the number of instructions of the original trace
+ */
+uint64_t replay_miss_trace(cache_base_c* cache, miss_trace_reader_c* reader, miss_trace_writer_c* miss_trace) {
+  uint64_t num_insts;
+  int type;
+  addr_t address;
+
+  while (reader->read(num_insts, type, address)) {
+    if (type == WRITE_BACK) {
+      if (!cache->access(address, WRITE_BACK, true) && miss_trace) {
+        miss_trace->write(num_insts, WRITE_BACK, address);
+      }
+    } else {
+      access(cache, num_insts, (type == WRITE) ? READ : type, address, miss_trace);
     }
   }
+  return reader->get_num_insts();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv) {
-  if (argc != 5) {
-    fprintf(stderr, "[Usage]: %s <trace> <cache size (in bytes)> <associativity> "
-                    "<line size (in bytes)> \n", argv[0]);
+  // options: -w <file> writes the miss stream of the cache; -r replays a
+  // miss trace (instead of a full trace) into the cache as the next level;
+  // -t <n> splits the sets among n worker threads
+  const char* miss_trace_name = nullptr;
+  bool replay = false;
+  int num_threads = 1;
+  const char* prog = argv[0];
+  while (argc > 1 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-w") && argc > 2) {
+      miss_trace_name = argv[2];
+      argc -= 2;
+      argv += 2;
+    } else if (!strcmp(argv[1], "-t") && argc > 2) {
+      num_threads = atoi(argv[2]);
+      argc -= 2;
+      argv += 2;
+    } else if (!strcmp(argv[1], "-r")) {
+      replay = true;
+      argc -= 1;
+      argv += 1;
+    } else {
+      break;
+    }
+  }
+
+  if (argc < 5 || argc > 7) {
+    fprintf(stderr, "[Usage]: %s [-w <miss trace out>] [-r] [-t <threads>] <trace | miss trace (-r)> <cache size (in bytes)> "
+                    "<associativity> <line size (in bytes)> [sample 1 of N sets] [classify misses (0/1)] \n", prog);
     return -1;
   }
   
@@ -44,10 +141,64 @@ int main(int argc, char** argv) {
   int num_line_size = atoi(argv[4]);
   int cache_size = atoi(argv[2]);
   int num_sets = cache_size / (num_assoc * num_line_size);
-  cache_base_c* cc = new cache_base_c("L1", num_sets, num_assoc, num_line_size);
+  int sample_sets = (argc >= 6) ? atoi(argv[5]) : 1;
+  bool classify = (argc >= 7) && atoi(argv[6]);
+  if (miss_trace_name && sample_sets > 1) {
+    fprintf(stderr, "a miss trace needs every set simulated (no sampling)\n");
+    return -1;
+  }
+  if (num_threads < 1 || num_threads > num_sets) {
+    fprintf(stderr, "threads must be between 1 and the number of sets\n");
+    return -1;
+  }
+  if (num_threads > 1 && (replay || miss_trace_name || classify)) {
+    fprintf(stderr, "-t does not combine with -r, -w or miss classification (they need the whole cache in order)\n");
+    return -1;
+  }
+
+  miss_trace_reader_c* reader = nullptr;
+  if (replay) {
+    reader = new miss_trace_reader_c(argv[1]);
+    if (!reader->is_open()) {
+      fprintf(stderr, "%s: not a miss trace\n", argv[1]);
+      return -1;
+    }
+  }
+  miss_trace_writer_c* writer = nullptr;
+  if (miss_trace_name) {
+    writer = new miss_trace_writer_c(miss_trace_name, num_line_size);
+    if (!writer->is_open()) {
+      fprintf(stderr, "%s: cannot write the miss trace\n", miss_trace_name);
+      return -1;
+    }
+  }
 
-  process_trace(cc, argv[1]);
+  // with worker threads, cc only collects their stats (and allocates no set)
+  std::string name = replay ? "L2" : "L1";
+  cache_base_c* cc = new cache_base_c(name, num_sets, num_assoc, num_line_size, num_threads > 1, sample_sets);
+  if (classify) cc->enable_miss_classification();
+  set_partition_c* partition = nullptr;
+  if (num_threads > 1) {
+    partition = new set_partition_c(name, num_sets, num_assoc, num_line_size, sample_sets, num_threads);
+  }
+
+  uint64_t num_insts = replay ? replay_miss_trace(cc, reader, writer) : process_trace(cc, argv[1], writer, partition);
+  if (partition) {
+    partition->finish(cc);
+    delete partition;
+  }
   cc->print_stats();
+  cc->print_sampling_stats();
+  if (classify) cc->get_miss_classifier()->print_stats(std::cout, name);
+  if (replay || writer) {
+    std::cout << "number of insts: " << num_insts << "\n";
+  }
+  if (writer) {
+    writer->close(num_insts);
+    std::cout << "miss trace records: " << writer->m_num_records << " (" << writer->m_num_bytes << " bytes)\n";
+    delete writer;
+  }
+  delete reader;
   //cc->dump_tag_store(false);  // uncomment this for debugging
   delete cc;
 
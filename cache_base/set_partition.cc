@@ -0,0 +1,95 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class set_partition_c
+ *
+ * Set-partitioned parallel simulation of one cache; see set_partition.h.
+ */
+
+#include "set_partition.h"
+
+#include <cassert>
+
+set_partition_c::set_partition_c(std::string name, int num_sets, int assoc, int line_size,
+                                 int sample_sets, int num_threads) {
+  assert(num_threads > 0 && num_threads <= num_sets);
+  m_num_sets = num_sets;
+  m_line_size = line_size;
+  m_finished = false;
+
+  for (int ii = 0; ii < num_threads; ++ii) {
+    worker_s* worker = new worker_s();
+    worker->m_cache = new cache_base_c(name, num_sets, assoc, line_size, true, sample_sets);
+    worker->m_pending.reserve(BATCH_SIZE);
+    worker->m_done = false;
+    m_workers.push_back(worker);
+  }
+  for (worker_s* worker : m_workers) {
+    worker->m_thread = std::thread(&set_partition_c::run_worker, this, worker);
+  }
+}
+
+set_partition_c::~set_partition_c() {
+  if (!m_finished) finish(nullptr);
+  for (worker_s* worker : m_workers) {
+    delete worker->m_cache;
+    delete worker;
+  }
+}
+
+void set_partition_c::access(addr_t address, int access_type) {
+  int set_index = (address / m_line_size) % m_num_sets;
+  worker_s* worker = m_workers[(int64_t)set_index * m_workers.size() / m_num_sets];
+
+  access_s req = {address, access_type};
+  worker->m_pending.push_back(req);
+  if ((int)worker->m_pending.size() == BATCH_SIZE) hand_over(worker);
+}
+
+void set_partition_c::hand_over(worker_s* worker) {
+  std::unique_lock<std::mutex> lock(worker->m_lock);
+  worker->m_cond.wait(lock, [worker] { return worker->m_queue.size() < MAX_BATCHES; });
+  worker->m_queue.push_back(std::move(worker->m_pending));
+  worker->m_cond.notify_all();
+  lock.unlock();
+
+  worker->m_pending.clear();
+  worker->m_pending.reserve(BATCH_SIZE);
+}
+
+void set_partition_c::run_worker(worker_s* worker) {
+  std::vector<access_s> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(worker->m_lock);
+      worker->m_cond.wait(lock, [worker] { return !worker->m_queue.empty() || worker->m_done; });
+      if (worker->m_queue.empty()) return;
+      batch = std::move(worker->m_queue.front());
+      worker->m_queue.pop_front();
+      worker->m_cond.notify_all();
+    }
+    worker->m_cache->access_batch(batch.data(), batch.size());
+  }
+}
+
+/**
+ * @param result - cache of the same geometry that receives the summed stats
+ *                 (nullptr: drop them)
+ */
+void set_partition_c::finish(cache_base_c* result) {
+  assert(!m_finished);
+  m_finished = true;
+
+  for (worker_s* worker : m_workers) {
+    if (!worker->m_pending.empty()) hand_over(worker);
+    std::lock_guard<std::mutex> lock(worker->m_lock);
+    worker->m_done = true;
+    worker->m_cond.notify_all();
+  }
+  for (worker_s* worker : m_workers) {
+    worker->m_thread.join();
+    if (result) result->merge_stats(*worker->m_cache);
+  }
+}
@@ -0,0 +1,63 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __SET_PARTITION_H__
+#define __SET_PARTITION_H__
+
+#include "cache_base.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ *
+ * @class set_partition_c
+ *
+ * Set-partitioned parallel simulation of one cache.  The sets of a single
+ * cache are independent, so worker ii owns the sets
+ * [ii * num_sets / n, (ii + 1) * num_sets / n) in a cache_base_c of its own
+ * (lazy_sets: it only ever allocates its slice, with its own counters).  The
+ * thread that reads the trace routes each record to the owner of its set in
+ * batches, so every set sees its records in trace order; merge_stats() then
+ * sums the workers' counters into exactly the stats of a serial run.
+ *
+ * The trace has to be read (and parsed) on one thread, which bounds the
+ * speedup; the workers pay for the tag lookups.
+ */
+class set_partition_c {
+public:
+  set_partition_c(std::string name, int num_sets, int assoc, int line_size, int sample_sets,
+                  int num_threads);
+  ~set_partition_c();
+
+  void access(addr_t address, int access_type);  // lookup + fill on a miss, by the set's owner
+  void finish(cache_base_c* result);             // drain, join the workers, add their stats to result
+
+private:
+  static const int BATCH_SIZE = 4096;    // records handed over at once
+  static const int MAX_BATCHES = 16;     // full batches queued per worker before the reader waits
+
+  struct worker_s {
+    cache_base_c* m_cache;               // owns a slice of the sets
+    std::vector<access_s> m_pending;     // (reader) batch being filled
+    std::deque<std::vector<access_s>> m_queue;  // full batches
+    bool m_done;                         // no more batches
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+  };
+
+  void run_worker(worker_s* worker);
+  void hand_over(worker_s* worker);      // queue the pending batch
+
+  std::vector<worker_s*> m_workers;
+  int m_num_sets;
+  int m_line_size;
+  bool m_finished;
+};
+
+#endif // !__SET_PARTITION_H__
@@ -0,0 +1,169 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class stats_registry_c
+ *
+ * Registry of named component statistics; see stats.h.
+ */
+
+#include "stats.h"
+
+#include <cassert>
+#include <fstream>
+
+namespace {
+/// one level of the path hierarchy while writing JSON
+struct stats_node_s {
+  std::string m_name;
+  int m_stat;                           ///< index of the statistic; -1 for a group
+  std::vector<stats_node_s> m_children; ///< in registration order
+};
+
+stats_node_s& child(stats_node_s& node, const std::string& name) {
+  for (stats_node_s& cc : node.m_children) {
+    if (cc.m_name == name) return cc;
+  }
+  stats_node_s cc;
+  cc.m_name = name;
+  cc.m_stat = -1;
+  node.m_children.push_back(cc);
+  return node.m_children.back();
+}
+
+double ratio(uint64_t numerator, uint64_t denominator) {
+  return denominator ? (double)numerator / denominator : 0.0;
+}
+}
+
+void stats_registry_c::add(const std::string& path, int kind, const uint64_t* value,
+                           const uint64_t* denominator, const histogram_c* histogram) {
+  stat_s stat;
+  stat.m_path = path;
+  stat.m_kind = kind;
+  stat.m_value = value;
+  stat.m_denominator = denominator;
+  stat.m_histogram = histogram;
+  m_stats.push_back(stat);
+}
+
+void stats_registry_c::add_counter(const std::string& path, const uint64_t* value) {
+  add(path, STAT_COUNTER, value, nullptr, nullptr);
+}
+
+void stats_registry_c::add_ratio(const std::string& path, const uint64_t* numerator,
+                                 const uint64_t* denominator) {
+  add(path, STAT_RATIO, numerator, denominator, nullptr);
+}
+
+void stats_registry_c::add_histogram(const std::string& path, const histogram_c* histogram) {
+  add(path, STAT_HISTOGRAM, nullptr, nullptr, histogram);
+}
+
+void stats_registry_c::write_json(std::ostream& os, const stat_s& stat) const {
+  switch (stat.m_kind) {
+    case STAT_COUNTER:
+      os << *stat.m_value;
+      break;
+    case STAT_RATIO:
+      os << ratio(*stat.m_value, *stat.m_denominator);
+      break;
+    case STAT_HISTOGRAM: {
+      const histogram_c* hh = stat.m_histogram;
+      int last = histogram_c::NUM_BUCKETS - 1;
+      while (last > 0 && !hh->m_bucket[last]) --last;
+
+      os << "{\"count\": " << hh->m_count << ", \"mean\": " << ratio(hh->m_sum, hh->m_count)
+         << ", \"buckets\": [";
+      for (int bb = 0; bb <= last; ++bb) {
+        os << (bb ? ", " : "") << hh->m_bucket[bb];
+      }
+      os << "]}";
+      break;
+    }
+    default:
+      assert(false);
+  }
+}
+
+void stats_registry_c::dump_json(std::ostream& os) const {
+  stats_node_s root;
+  root.m_stat = -1;
+  for (size_t ii = 0; ii < m_stats.size(); ++ii) {
+    stats_node_s* node = &root;
+    const std::string& path = m_stats[ii].m_path;
+    for (size_t begin = 0; begin <= path.size(); ) {
+      size_t end = path.find('.', begin);
+      if (end == std::string::npos) end = path.size();
+      node = &child(*node, path.substr(begin, end - begin));
+      begin = end + 1;
+    }
+    assert(node->m_stat == -1 && node->m_children.empty() && "duplicate stats path");
+    node->m_stat = ii;
+  }
+
+  // depth-first, one member per line
+  struct writer_s {
+    const stats_registry_c* m_registry;
+    std::ostream& m_os;
+    void write(const stats_node_s& node, int indent) {
+      if (node.m_stat >= 0) {
+        m_registry->write_json(m_os, m_registry->m_stats[node.m_stat]);
+        return;
+      }
+      m_os << "{\n";
+      for (size_t ii = 0; ii < node.m_children.size(); ++ii) {
+        const stats_node_s& cc = node.m_children[ii];
+        m_os << std::string(indent + 2, ' ') << "\"" << cc.m_name << "\": ";
+        write(cc, indent + 2);
+        m_os << (ii + 1 < node.m_children.size() ? ",\n" : "\n");
+      }
+      m_os << std::string(indent, ' ') << "}";
+    }
+  } writer = {this, os};
+
+  writer.write(root, 0);
+  os << "\n";
+}
+
+void stats_registry_c::dump_csv(std::ostream& os) const {
+  os << "stat,value\n";
+  for (const stat_s& stat : m_stats) {
+    switch (stat.m_kind) {
+      case STAT_COUNTER:
+        os << stat.m_path << "," << *stat.m_value << "\n";
+        break;
+      case STAT_RATIO:
+        os << stat.m_path << "," << ratio(*stat.m_value, *stat.m_denominator) << "\n";
+        break;
+      case STAT_HISTOGRAM: {
+        const histogram_c* hh = stat.m_histogram;
+        os << stat.m_path << ".count," << hh->m_count << "\n";
+        os << stat.m_path << ".mean," << ratio(hh->m_sum, hh->m_count) << "\n";
+        for (int bb = 0; bb < histogram_c::NUM_BUCKETS; ++bb) {
+          if (!hh->m_bucket[bb]) continue;
+          // bucket label: its lower bound
+          os << stat.m_path << ".bucket_" << (bb ? (uint64_t)1 << (bb - 1) : 0) << ","
+             << hh->m_bucket[bb] << "\n";
+        }
+        break;
+      }
+      default:
+        assert(false);
+    }
+  }
+}
+
+bool stats_registry_c::dump(const std::string& filename) const {
+  std::ofstream ofs(filename);
+  if (!ofs.is_open()) return false;
+
+  bool is_csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+  if (is_csv) {
+    dump_csv(ofs);
+  } else {
+    dump_json(ofs);
+  }
+  return true;
+}
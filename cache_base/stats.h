@@ -0,0 +1,80 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ *
+ * @class histogram_c
+ *
+ * Histogram with power-of-two buckets: bucket 0 counts zeros, bucket k
+ * counts values in [2^(k-1), 2^k).  Sampling is a few instructions.
+ */
+class histogram_c {
+public:
+  static const int NUM_BUCKETS = 48;
+
+  histogram_c() : m_bucket(), m_count(0), m_sum(0) {}
+
+  void sample(uint64_t value) {
+    int bucket = 0;
+    while (value >> bucket && bucket < NUM_BUCKETS - 1) ++bucket;
+    ++m_bucket[bucket];
+    ++m_count;
+    m_sum += value;
+  }
+
+  uint64_t m_bucket[NUM_BUCKETS];  ///< samples per bucket
+  uint64_t m_count;                ///< number of samples
+  uint64_t m_sum;                  ///< sum of the samples
+};
+
+/**
+ *
+ * @class stats_registry_c
+ *
+ * Named statistics of the simulated components.  A component keeps its
+ * counters as plain 64-bit members (an increment on the hot path) and
+ * registers their addresses under a hierarchical, dot-separated path
+ * (e.g. "l1d.hits"); the registry only reads them when it is dumped, which
+ * can happen at the end of the run or at any point during it.  Registered
+ * components must outlive the registry (or at least its last dump).
+ *
+ * JSON: one nested object per path component.
+ * CSV:  "path,value" per line (histograms: count, mean and non-empty buckets).
+ */
+class stats_registry_c {
+public:
+  void add_counter(const std::string& path, const uint64_t* value);
+  void add_ratio(const std::string& path, const uint64_t* numerator, const uint64_t* denominator);
+  void add_histogram(const std::string& path, const histogram_c* histogram);
+
+  void dump_json(std::ostream& os) const;
+  void dump_csv(std::ostream& os) const;
+  bool dump(const std::string& filename) const;  ///< ".csv": CSV; otherwise JSON
+
+private:
+  enum STAT_KIND { STAT_COUNTER, STAT_RATIO, STAT_HISTOGRAM };
+
+  struct stat_s {
+    std::string m_path;
+    int m_kind;                      ///< STAT_KIND
+    const uint64_t* m_value;         ///< counter; ratio numerator
+    const uint64_t* m_denominator;   ///< ratio denominator
+    const histogram_c* m_histogram;  ///< histogram
+  };
+
+  void add(const std::string& path, int kind, const uint64_t* value,
+           const uint64_t* denominator, const histogram_c* histogram);
+  void write_json(std::ostream& os, const stat_s& stat) const;
+
+  std::vector<stat_s> m_stats;       ///< in registration order
+};
+
+#endif // !__STATS_H__
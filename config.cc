@@ -2,6 +2,8 @@
 
 #include <fstream>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 #include <vector>
 
 config_c::config_c(const std::string& fname) {
@@ -31,37 +33,158 @@ void config_c::parse(const std::string& fname) {
       line = line.substr(end);
     }
 
-    if (tokens[0] == "mem_hierarchy") {
-      mem_hierarchy = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1i_size") {
-      l1i_size = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1i_assoc") {
-      l1i_assoc = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1i_line_size") {
-      l1i_line_size = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1i_latency") {
-      l1i_latency = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1d_size") {
-      l1d_size = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1d_assoc") {
-      l1d_assoc = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1d_line_size") {
-      l1d_line_size = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l1d_latency") {
-      l1d_latency = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l2_size") {
-      l2_size = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l2_assoc") {
-      l2_assoc = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l2_line_size") {
-      l2_line_size = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "l2_latency") {
-      l2_latency = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "memory_latency") {
-      memory_latency = atoi(tokens[1].c_str());
-    } else if (tokens[0] == "single_request") {
-      single_request = atoi(tokens[1].c_str());
-    }
+    if (tokens.size() < 2 || tokens[0][0] == '#')
+      continue;
+
+    set_param(tokens[0], atoi(tokens[1].c_str()));
+    m_strings[tokens[0]] = tokens[1];
   }
   file.close();
 }
+
+/**
+ * Set one parameter, as if it were read from the config file (later values
+ * override earlier ones).
+ */
+void config_c::set_param(const std::string& key, int value) {
+  m_params[key] = value;
+
+  if (key == "mem_hierarchy") {
+    mem_hierarchy = value;
+  } else if (key == "l1i_size") {
+    l1i_size = value;
+  } else if (key == "l1i_assoc") {
+    l1i_assoc = value;
+  } else if (key == "l1i_line_size") {
+    l1i_line_size = value;
+  } else if (key == "l1i_latency") {
+    l1i_latency = value;
+  } else if (key == "l1d_size") {
+    l1d_size = value;
+  } else if (key == "l1d_assoc") {
+    l1d_assoc = value;
+  } else if (key == "l1d_line_size") {
+    l1d_line_size = value;
+  } else if (key == "l1d_latency") {
+    l1d_latency = value;
+  } else if (key == "l2_size") {
+    l2_size = value;
+  } else if (key == "l2_assoc") {
+    l2_assoc = value;
+  } else if (key == "l2_line_size") {
+    l2_line_size = value;
+  } else if (key == "l2_latency") {
+    l2_latency = value;
+  } else if (key == "memory_latency") {
+    memory_latency = value;
+  } else if (key == "single_request") {
+    single_request = value;
+  } else if (key == "parallel_sim") {
+    parallel_sim = value;
+  }
+}
+
+bool config_c::has_param(const std::string& key) const {
+  return m_params.find(key) != m_params.end();
+}
+
+int config_c::get_param(const std::string& key) const {
+  auto it = m_params.find(key);
+  if (it == m_params.end()) {
+    fprintf(stderr, "config: missing parameter '%s'\n", key.c_str());
+    assert(false && "Missing config parameter");
+  }
+  return it->second;
+}
+
+int config_c::get_param(const std::string& key, int default_value) const {
+  auto it = m_params.find(key);
+  return (it == m_params.end()) ? default_value : it->second;
+}
+
+std::string config_c::get_string(const std::string& key, const std::string& default_value) const {
+  auto it = m_strings.find(key);
+  return (it == m_strings.end()) ? default_value : it->second;
+}
+
+/**
+ * Split L1 I/D caches by default whenever there is a lower level (as in the
+ * original multi-level hierarchy); a single-level hierarchy is unified.
+ */
+int config_c::is_l1_split() const {
+  return get_param("l1_split", mem_hierarchy >= 2);
+}
+
+/**
+ * Collect the parameters of one cache, e.g. "l3" reads l3_size, l3_assoc,
+ * l3_line_size, l3_latency and l3_inclusion.  A unified L1 ("l1") falls back
+ * to the l1d_* keys so that single-level configs keep working.
+ */
+cache_config_s config_c::get_cache_config(const std::string& prefix) const {
+  std::string p = prefix;
+  if (prefix == "l1" && !has_param("l1_size")) p = "l1d";
+
+  cache_config_s cc;
+  cc.size      = get_param(p + "_size");
+  cc.assoc     = get_param(p + "_assoc");
+  cc.line_size = get_param(p + "_line_size");
+  cc.latency   = get_param(p + "_latency");
+  cc.inclusion = get_param(p + "_inclusion", 0);
+  cc.victim_entries = get_param(p + "_victim_entries", 0);
+  cc.victim_latency = get_param(p + "_victim_latency", 1);
+  cc.write_buffer_entries = get_param(p + "_write_buffer_entries", 0);
+  cc.write_policy = get_param(p + "_write_policy", 0);
+  cc.write_allocate = get_param(p + "_write_allocate", 1);
+  cc.lazy_sets = get_param(p + "_lazy_sets", 0);
+  cc.sample_sets = get_param(p + "_sample_sets", 0);
+  cc.attribution = get_param(p + "_attribution", 0);
+  cc.classify_misses = get_param(p + "_classify_misses", 0);
+  cc.sector_size = get_param(p + "_sector_size", 0);
+  cc.way_partition = get_param(p + "_way_partition", 0);
+  cc.inst_way_mask = strtoul(get_string(p + "_inst_way_mask", "0").c_str(), nullptr, 0);  // hex or decimal
+  cc.data_way_mask = strtoul(get_string(p + "_data_way_mask", "0").c_str(), nullptr, 0);
+  cc.partition_interval = get_param(p + "_partition_interval", 10000);
+  return cc;
+}
+
+/**
+ * Collect the address-translation parameters (tlb, *tlb_*, page_* keys).
+ */
+mmu_config_s config_c::get_mmu_config() const {
+  mmu_config_s mc;
+  mc.enable = get_param("tlb", 0);
+
+  mc.itlb.entries = get_param("itlb_entries", 64);
+  mc.itlb.assoc   = get_param("itlb_assoc", 4);
+  mc.itlb.latency = get_param("itlb_latency", 0);
+  mc.dtlb.entries = get_param("dtlb_entries", 64);
+  mc.dtlb.assoc   = get_param("dtlb_assoc", 4);
+  mc.dtlb.latency = get_param("dtlb_latency", 0);
+  mc.stlb.entries = get_param("stlb_entries", 1536);
+  mc.stlb.assoc   = get_param("stlb_assoc", 12);
+  mc.stlb.latency = get_param("stlb_latency", 7);
+
+  mc.page_alloc   = get_param("page_alloc", 0);
+  mc.phys_mem_mb  = get_param("phys_mem_mb", 4096);
+  mc.page_walkers = get_param("page_walkers", 2);
+  mc.seed         = get_param("page_alloc_seed", 1);
+  return mc;
+}
+
+/**
+ * Collect the parameters of the built-in synthetic workload (wl_* keys).
+ */
+workload_config_s config_c::get_workload_config() const {
+  workload_config_s wc;
+  wc.pattern      = get_param("wl_pattern", 1);
+  wc.num_insts    = get_param("wl_num_insts", 100000);
+  wc.footprint    = get_param("wl_footprint", 1 << 20);
+  wc.stride       = get_param("wl_stride", 64);
+  wc.dim          = get_param("wl_dim", 64);
+  wc.code_size    = get_param("wl_code_size", 4096);
+  wc.data_percent = get_param("wl_data_percent", 40);
+  wc.write_percent = get_param("wl_write_percent", 30);
+  wc.gap_insts    = get_param("wl_gap_insts", 0);
+  wc.seed         = get_param("wl_seed", 1);
+  return wc;
+}
@@ -1,7 +1,67 @@
 #ifndef __CONFIG_H__
 #define __CONFIG_H__
 
+#include <cstdint>
 #include <string>
+#include <map>
+
+/// parameters of one cache in the hierarchy
+struct cache_config_s {
+  int size;         ///< capacity in bytes
+  int assoc;        ///< associativity
+  int line_size;    ///< line size in bytes
+  int latency;      ///< hit latency in cycles
+  int inclusion;    ///< inclusion policy w.r.t. the upper level (see INCLUSION_POLICY)
+  int victim_entries;  ///< (L1 only) victim cache entries; 0: no victim cache
+  int victim_latency;  ///< (L1 only) victim cache hit latency in cycles
+  int write_buffer_entries;  ///< write buffer entries; 0: write-backs go down unbuffered
+  int write_policy;  ///< write-back or write-through (see WRITE_POLICY)
+  int write_allocate;  ///< a write miss fetches the line; 0: the write goes on to the next level
+  int lazy_sets;    ///< allocate tag-store sets on first touch (for very large caches)
+  int sample_sets;  ///< set sampling: simulate 1 of every N sets; 0 or 1: all sets
+  int attribution;  ///< miss attribution: report the top N sets/pages; 0: off
+  int classify_misses;  ///< three-C miss classification (compulsory/capacity/conflict)
+  int sector_size;  ///< sectored lines: bytes per sector; 0: one sector per line
+  int way_partition;    ///< ways split between instruction and data lines (see WAY_PARTITION)
+  uint32_t inst_way_mask;  ///< (fixed) ways instruction fetches may fill
+  uint32_t data_way_mask;  ///< (fixed) ways data accesses may fill
+  int partition_interval;  ///< (utility-based) accesses between repartitions
+
+  int get_num_sets() const { return size / (assoc * line_size); }
+};
+
+/// parameters of one TLB
+struct tlb_config_s {
+  int entries;      ///< number of entries
+  int assoc;        ///< associativity
+  int latency;      ///< extra cycles on a hit
+};
+
+/// address translation (see mmu_c)
+struct mmu_config_s {
+  int enable;           ///< translate addresses (tlb = 1)
+  tlb_config_s itlb;    ///< L1 instruction TLB
+  tlb_config_s dtlb;    ///< L1 data TLB
+  tlb_config_s stlb;    ///< unified L2 TLB
+  int page_alloc;       ///< page allocation policy (see PAGE_ALLOC_POLICY)
+  int phys_mem_mb;      ///< physical memory in MB (power of two)
+  int page_walkers;     ///< concurrent page walks
+  int seed;             ///< seed of the random page allocation
+};
+
+/// parameters of the built-in synthetic workload (see synthetic_workload_c)
+struct workload_config_s {
+  int pattern;        ///< access pattern (see WORKLOAD_PATTERN)
+  int num_insts;      ///< number of instructions to generate
+  int footprint;      ///< data footprint in bytes (seq, stride, random, pointer chase)
+  int stride;         ///< stride in bytes (stride)
+  int dim;            ///< grid/matrix dimension (stencil, matmul)
+  int code_size;      ///< size of the instruction loop in bytes
+  int data_percent;   ///< % of instructions that access data
+  int write_percent;  ///< % of data accesses that are writes (seq, stride, random, pointer chase)
+  int gap_insts;      ///< non-memory instructions before each fetched instruction
+  int seed;           ///< random seed
+};
 
 class config_c {
 public:
@@ -9,9 +69,13 @@ public:
   config_c(const std::string& fname);
 
   void parse(const std::string& fname);
+  void set_param(const std::string& key, int value);
 
   int get_mem_hierarchy() const {return mem_hierarchy;}
+  int get_num_levels() const {return mem_hierarchy;}
+  int is_l1_split() const;
   int is_single_request() const {return single_request;}
+  int is_parallel_sim() const {return parallel_sim;}
   
   // L1 instruction cache
   int get_l1i_size() const {return l1i_size;}
@@ -33,9 +97,25 @@ public:
 
   int get_memory_latency() const {return memory_latency;} 
 
+  // any cache by key prefix: "l1i", "l1d", "l1" (unified L1), "l2", "l3", ...
+  cache_config_s get_cache_config(const std::string& prefix) const;
+
+  // address translation ("tlb", "*tlb_*", "page_*" keys)
+  mmu_config_s get_mmu_config() const;
+
+  // synthetic workload ("wl_*" keys)
+  workload_config_s get_workload_config() const;
+
+  // raw access to any parsed key
+  bool has_param(const std::string& key) const;
+  int get_param(const std::string& key) const;
+  int get_param(const std::string& key, int default_value) const;
+  std::string get_string(const std::string& key, const std::string& default_value) const;
+
 private:
   int mem_hierarchy;
   int single_request;
+  int parallel_sim = 0;
 
   int l1i_size;
   int l1i_assoc;
@@ -53,6 +133,9 @@ private:
   int l2_latency;
 
   int memory_latency;
+
+  std::map<std::string, int> m_params;  ///< every key in the config file
+  std::map<std::string, std::string> m_strings;  ///< the same keys, unparsed values
 };
 
 #endif // !__CONFIG_H__
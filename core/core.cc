@@ -4,6 +4,8 @@
 #include "core.h"
 #include "memory_system/memory_hierarchy.h"
 
+#include <cassert>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 
@@ -14,6 +16,35 @@ core_c::core_c(memory_hierarchy_c* mm) {
 
   m_num_insts = 0;
   m_num_mem_insts = 0;
+  m_num_nonmem_insts = 0;
+  m_num_stall_cycles = 0;
+
+  m_issue_width = mm->m_config.get_param("issue_width", 1);
+  if (m_issue_width < 1) {
+    fprintf(stderr, "config: issue_width must be at least 1\n");
+    assert(false && "Bad issue_width");
+  }
+
+  m_progress_interval = mm->m_config.get_param("progress_interval", 1);
+  m_show_progress = m_progress_interval > 0;
+  m_report_insts = 0;
+  m_report_cycle = 0;
+  m_single_request = mm->m_config.is_single_request();
+  m_functional = mm->is_functional();
+
+  m_warmup_insts = mm->m_config.get_param("warmup_insts", 0);
+  m_roi_insts = mm->m_config.get_param("roi_insts", 0);
+  m_roi_state = (m_warmup_insts > 0) ? ROI_WARMUP : ROI_ACTIVE;
+  m_num_warmup_insts = 0;
+  m_stats_reset = false;
+
+  mm->m_stats.add_counter("core.cycles", &m_cycle);
+  mm->m_stats.add_counter("core.insts", &m_num_insts);
+  mm->m_stats.add_counter("core.mem_insts", &m_num_mem_insts);
+  mm->m_stats.add_counter("core.nonmem_insts", &m_num_nonmem_insts);
+  mm->m_stats.add_counter("core.stall_cycles", &m_num_stall_cycles);
+  mm->m_stats.add_ratio("core.cpi", &m_cycle, &m_num_insts);
+  mm->m_stats.add_ratio("core.stall_fraction", &m_num_stall_cycles, &m_cycle);
 }
 
 // destructor
@@ -25,54 +56,203 @@ core_c::~core_c() {
  * @param filename - name of the trace file
  */
 void core_c::run_sim(std::string filename) {
-  std::ifstream trace_file(filename);
+  trace_workload_c trace(filename);
 
-  if (!trace_file.is_open()) 
+  if (!trace.is_open()) 
     return; 
 
-  std::string line;
+  run_sim(&trace);
+}
+
+/**
+ * This runs simulation with a given workload (trace file or synthetic)
+ * @param workload - source of the memory references
+ *
+ * One record issues per cycle.  The non-memory instructions in front of a
+ * record (its gap) retire first, issue_width per cycle, and the record issues
+ * in the cycle with the ones left over.  A cycle in which nothing issues
+ * because of memory (single_request, and the final drain) is a stall cycle.
+ */
+void core_c::run_sim(workload_c* workload) {
   addr_t address;
   int type;
+  counter num_records = 0;
+
+  m_start_time = m_report_time = std::chrono::steady_clock::now();
+  m_report_insts = m_num_insts;
+  m_report_cycle = m_cycle;
 
   while (true) {
-    if (!m_mm->m_config.is_single_request() || m_mm->get_num_in_flight_reqs() == 0) {
-      std::getline(trace_file, line);
-      if (trace_file.eof()) break;
+    if (!m_single_request || m_mm->get_num_in_flight_reqs() == 0) {
+      {
+        profile_scope_c profile(m_mm->m_profiler, PROF_WORKLOAD);
+        if (!workload->next(type, address)) break;
+      }
+
+      int gap = workload->get_gap();
+      if (gap > 0) {
+        m_num_insts += gap;
+        m_num_nonmem_insts += gap;
+        for (; gap >= m_issue_width; gap -= m_issue_width) {
+          run_a_cycle();
+        }
+      }
 
-      std::sscanf(line.c_str(), "%d %lx", &type,  &address);
+      if (type == TRACE_MARKER) {
+        if (address == MARKER_RESET_STATS) reset_stats();
+        else if (address == MARKER_ROI_START) start_roi();
+        else if (address == MARKER_ROI_END) m_roi_state = ROI_DONE;
 
+        if (m_roi_state == ROI_DONE) break;
+        continue;  // not an instruction: no cycle
+      }
+
+      // the warmup and the ROI end between two instructions, with the data
+      // accesses of the last one (after a gap that crosses the boundary)
       if (type == REQ_IFETCH) {
-        m_mm->access(address, type);
-        m_num_insts++;
+        if (m_roi_state == ROI_WARMUP && m_num_insts >= (counter)m_warmup_insts) {
+          start_roi();
+        } else if (m_roi_state == ROI_ACTIVE && m_roi_insts > 0 && m_num_insts >= (counter)m_roi_insts) {
+          m_roi_state = ROI_DONE;
+          break;
+        }
+      }
 
-        if (m_num_insts % 10000 == 0) {
-          std::cout <<"Processed " << m_num_insts << " instructions\n";
+      {
+        profile_scope_c profile(m_mm->m_profiler, PROF_ISSUE);
+        if (type == REQ_IFETCH) {
+          issue(address, type);
+          m_num_insts++;
+        } else if (type == REQ_DFETCH || type == REQ_DSTORE) {
+          issue(address, type);
+          m_num_mem_insts++;
         }
+      }
 
-      } else if (type == REQ_DFETCH || type == REQ_DSTORE) {
-        m_mm->access(address, type);
-        m_num_mem_insts++;
+      if (m_show_progress && ++num_records % PROGRESS_CHECK == 0) {
+        report_progress(workload, false);
       }
+    } else {
+      ++m_num_stall_cycles;
     }
 
     run_a_cycle();
   }
 
+  // functional mode: the write-backs of the last access
+  if (m_functional) m_mm->drain_functional();
+
   // keep running until all in-flight requests and write-backs are committed
   while (m_mm->get_num_in_flight_reqs() != 0 || !m_mm->is_wb_done()) {
+    ++m_num_stall_cycles;
     run_a_cycle();
   }
- 
+
+  if (m_show_progress) report_progress(workload, true);
+}
+
+/**
+ * Progress line on stderr, at most once per progress_interval seconds:
+ * instructions so far, the simulation speed since the last report (KIPS and
+ * simulated cycles per second) and, if the workload knows how far it is, the
+ * fraction done and an estimate of the remaining time.  At the end (done),
+ * the average speed of the whole run.
+ */
+void core_c::report_progress(workload_c* workload, bool done) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double interval = std::chrono::duration<double>(now - m_report_time).count();
+  double elapsed = std::chrono::duration<double>(now - m_start_time).count();
+
+  if (done) {
+    fprintf(stderr, "Simulated %llu instructions, %llu cycles in %.1f s (%.1f KIPS, %.1f K cycles/s)\n",
+            (unsigned long long)m_num_insts, (unsigned long long)m_cycle, elapsed,
+            elapsed > 0 ? m_num_insts / elapsed / 1000 : 0.0, elapsed > 0 ? m_cycle / elapsed / 1000 : 0.0);
+    return;
+  }
+  if (interval < m_progress_interval) return;
+
+  fprintf(stderr, "Processed %llu instructions (%.1f KIPS, %.1f K cycles/s)", (unsigned long long)m_num_insts,
+          (m_num_insts - m_report_insts) / interval / 1000, (m_cycle - m_report_cycle) / interval / 1000);
+
+  double progress = workload->get_progress();
+  if (progress > 0 && progress <= 1) {
+    int eta = (int)(elapsed * (1 - progress) / progress);
+    fprintf(stderr, ", %.1f%% done, ETA %dm %02ds", 100 * progress, eta / 60, eta % 60);
+  }
+  fprintf(stderr, "\n");
+
+  m_report_time = now;
+  m_report_insts = m_num_insts;
+  m_report_cycle = m_cycle;
+}
+
+void core_c::print_stats() {
   std::cout << "------------------------------" << std::endl;
   std::cout << "Performance Stats" << std::endl;
   std::cout << "------------------------------" << std::endl;
-  std::cout << "CPI:  " << ((float) m_cycle / m_num_insts) << std::endl;
-  std::cout << "number of cycles: " << m_cycle << std::endl;
+  if (m_functional) {
+    std::cout << "functional mode: no timing" << std::endl;
+  } else {
+    std::cout << "CPI:  " << ((float) m_cycle / m_num_insts) << std::endl;
+    std::cout << "number of cycles: " << m_cycle << std::endl;
+  }
   std::cout << "number of insts: " << m_num_insts << std::endl;
   std::cout << "number of memory insts: " << m_num_mem_insts << std::endl;
+  // cycle accounting (traces with gaps, or a wider core)
+  if (m_num_nonmem_insts > 0 || m_issue_width > 1) {
+    std::cout << "number of non-memory insts: " << m_num_nonmem_insts << std::endl;
+    if (!m_functional) {
+      std::cout << "issue width: " << m_issue_width << std::endl;
+      std::cout << "memory stall cycles: " << m_num_stall_cycles << " ("
+                << (m_cycle ? 100.0 * m_num_stall_cycles / m_cycle : 0.0) << " %)" << std::endl;
+    }
+  }
+  if (m_stats_reset) {
+    std::cout << "number of warmup insts (not counted): " << m_num_warmup_insts << std::endl;
+  }
 }
 
+/**
+ * Zero the stats of the core and of every level of the memory hierarchy in
+ * the same cycle; the caches keep their contents.
+ */
+void core_c::reset_stats() {
+  m_num_warmup_insts += m_num_insts;
+  m_stats_reset = true;
+
+  m_cycle = 0;
+  m_num_insts = 0;
+  m_num_mem_insts = 0;
+  m_num_nonmem_insts = 0;
+  m_num_stall_cycles = 0;
+  m_report_insts = 0;
+  m_report_cycle = 0;
+  m_mm->reset_stats();
+}
+
+void core_c::start_roi() {
+  reset_stats();
+  m_roi_state = ROI_ACTIVE;
+}
+
+/**
+ * Send a record to the memory hierarchy: as a request, or in functional mode
+ * straight through the caches.
+ */
+void core_c::issue(addr_t address, int type) {
+  if (m_functional) {
+    m_mm->access_functional(address, type);
+  } else {
+    m_mm->access(address, type);
+  }
+}
+
+/**
+ * Tick a cycle; in functional mode no time passes.
+ */
 void core_c::run_a_cycle() {
+  if (m_functional) return;
+
   m_mm->run_a_cycle();
 
   ++m_cycle;
@@ -5,6 +5,8 @@
 #define __CORE_H__
 
 #include "memory_system/memory_hierarchy.h"
+#include "workload.h"
+#include <chrono>
 #include <string>
 
 class core_c {
@@ -13,9 +15,17 @@ public:
   ~core_c();
 
   void run_sim(std::string filename);
+  void run_sim(workload_c* workload);
+  void print_stats();
 
 private:
   void run_a_cycle();
+  void issue(addr_t address, int type);  // one record to the memory hierarchy
+  void report_progress(workload_c* workload, bool done);  // simulation speed on stderr
+  void reset_stats();          // zero the core and memory stats (see m_roi_state)
+  void start_roi();            // end of the warmup
+
+  static const int PROGRESS_CHECK = 4096;  // records between looks at the clock
 
 public:
   memory_hierarchy_c* m_mm;
@@ -23,6 +33,29 @@ public:
 
   counter m_num_insts;         // # instructions (this includes #mem insts)
   counter m_num_mem_insts;     // # memory instructions 
+  counter m_num_nonmem_insts;  // # non-memory instructions (record gaps; included in m_num_insts)
+  counter m_num_stall_cycles;  // # cycles nothing issued while waiting for memory
+  int m_issue_width;           // instructions retired per cycle (issue_width)
+
+  bool m_show_progress;        // report progress and speed (see report_progress)
+  int m_progress_interval;     // seconds between progress reports (progress_interval; 0: off)
+  std::chrono::steady_clock::time_point m_start_time;   // start of run_sim
+  std::chrono::steady_clock::time_point m_report_time;  // last progress report
+  counter m_report_insts;      // m_num_insts at the last report
+  counter m_report_cycle;      // m_cycle at the last report
+  bool m_single_request;       // one request in flight at a time (from the config)
+  bool m_functional;           // caches only, no cycles (functional_sim)
+
+  // warmup and region of interest: stats are zeroed at the end of the
+  // warmup (after warmup_insts instructions or at a ROI start marker) and
+  // the run stops at the end of the ROI (after roi_insts more instructions
+  // or at a ROI end marker); requests still in flight then are counted
+  enum ROI_STATE { ROI_WARMUP = 0, ROI_ACTIVE, ROI_DONE };
+  int m_roi_state;             // ROI_STATE
+  int m_warmup_insts;          // warmup length (warmup_insts; 0: none)
+  int m_roi_insts;             // ROI length (roi_insts; 0: until the end of the workload)
+  counter m_num_warmup_insts;  // instructions whose stats were discarded
+  bool m_stats_reset;          // reset_stats was called
 };
 
 #endif // !__CORE_H__
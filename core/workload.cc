@@ -0,0 +1,165 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "workload.h"
+
+#include <cassert>
+#include <cstdio>
+
+namespace {
+const addr_t CODE_BASE = 0x400000;      ///< instruction loop
+const addr_t DATA_BASE = 0x10000000;    ///< first data array
+const int    ELEM_SIZE = 8;             ///< element size (double / pointer)
+const int    LINE_SIZE = 64;            ///< pointer chase: one node per line
+}
+
+///////////////////////////////////////////////////////////////////
+// trace_workload_c
+///////////////////////////////////////////////////////////////////
+
+trace_workload_c::trace_workload_c(const std::string& filename) : m_file(filename) {
+  m_gap = 0;
+  m_size = m_file.seekg(0, std::ios::end).tellg();
+  m_file.clear();
+  m_file.seekg(0, std::ios::beg);
+  m_file.clear();
+}
+
+bool trace_workload_c::next(int& type, addr_t& address) {
+  std::getline(m_file, m_line);
+  if (m_file.eof()) return false;
+
+  if (std::sscanf(m_line.c_str(), "%d %lx %d", &type, &address, &m_gap) < 3) m_gap = 0;
+  return true;
+}
+
+double trace_workload_c::get_progress() {
+  if (m_size <= 0) return -1.0;
+  std::streamoff pos = m_file.tellg();
+  return (pos < 0) ? -1.0 : (double)pos / m_size;
+}
+
+///////////////////////////////////////////////////////////////////
+// synthetic_workload_c
+///////////////////////////////////////////////////////////////////
+
+synthetic_workload_c::synthetic_workload_c(const workload_config_s& wc)
+    : m_config(wc), m_rng(wc.seed) {
+  assert(wc.pattern >= WL_SEQUENTIAL && wc.pattern < WL_LAST && "Unknown wl_pattern");
+  assert(wc.footprint >= LINE_SIZE && wc.code_size >= 4 && wc.dim >= 3);
+
+  m_num_insts = 0;
+  m_data_pending = false;
+  m_gap = 0;
+
+  m_pos = 0;
+  m_cur = 0;
+  m_i = (wc.pattern == WL_STENCIL) ? 1 : 0;  // stencil: interior points only
+  m_j = m_i;
+  m_k = 0;
+  m_step = 0;
+
+  // pointer chase: a single random cycle through every line (Sattolo)
+  if (wc.pattern == WL_POINTER_CHASE) {
+    uint32_t num_nodes = wc.footprint / LINE_SIZE;
+    std::vector<uint32_t> order(num_nodes);
+    for (uint32_t ii = 0; ii < num_nodes; ++ii) order[ii] = ii;
+    for (uint32_t ii = num_nodes - 1; ii > 0; --ii) {
+      uint32_t jj = m_rng() % ii;
+      std::swap(order[ii], order[jj]);
+    }
+    m_chase.resize(num_nodes);
+    for (uint32_t ii = 0; ii < num_nodes; ++ii) {
+      m_chase[order[ii]] = order[(ii + 1) % num_nodes];
+    }
+  }
+}
+
+bool synthetic_workload_c::next(int& type, addr_t& address) {
+  if (m_data_pending) {
+    m_data_pending = false;
+    m_gap = 0;
+    address = next_data(type);
+    return true;
+  }
+
+  if (m_num_insts == (counter)m_config.num_insts) return false;
+
+  type = INST_FETCH;
+  address = CODE_BASE + (m_num_insts * 4) % m_config.code_size;
+  m_gap = m_config.gap_insts;
+  ++m_num_insts;
+
+  m_data_pending = (int)(m_rng() % 100) < m_config.data_percent;
+  return true;
+}
+
+int synthetic_workload_c::random_type() {
+  return ((int)(m_rng() % 100) < m_config.write_percent) ? WRITE : READ;
+}
+
+addr_t synthetic_workload_c::next_data(int& type) {
+  const addr_t n = m_config.dim;
+  const addr_t array_size = n * n * ELEM_SIZE;
+
+  switch (m_config.pattern) {
+    case WL_SEQUENTIAL:
+    case WL_STRIDED: {
+      m_pos += (m_config.pattern == WL_SEQUENTIAL) ? ELEM_SIZE : m_config.stride;
+      type = random_type();
+      return DATA_BASE + m_pos % m_config.footprint;
+    }
+    case WL_RANDOM: {
+      type = random_type();
+      return DATA_BASE + (m_rng() % (m_config.footprint / ELEM_SIZE)) * ELEM_SIZE;
+    }
+    case WL_POINTER_CHASE: {
+      m_cur = m_chase[m_cur];
+      type = random_type();
+      return DATA_BASE + (addr_t)m_cur * LINE_SIZE;
+    }
+    case WL_STENCIL: {
+      // B[i][j] = f(A[i][j], A[i-1][j], A[i+1][j], A[i][j-1], A[i][j+1])
+      static const int di[] = {0, -1, 1, 0, 0, 0};
+      static const int dj[] = {0, 0, 0, -1, 1, 0};
+      addr_t base = (m_step == 5) ? DATA_BASE + array_size : DATA_BASE;
+      addr_t addr = base + ((m_i + di[m_step]) * n + (m_j + dj[m_step])) * ELEM_SIZE;
+      type = (m_step == 5) ? WRITE : READ;
+
+      if (++m_step == 6) {
+        m_step = 0;
+        if (++m_j == (int)n - 1) {
+          m_j = 1;
+          if (++m_i == (int)n - 1) m_i = 1;
+        }
+      }
+      return addr;
+    }
+    case WL_MATMUL: {
+      // for i, j: { for k: read A[i][k], B[k][j] }; write C[i][j]
+      addr_t addr;
+      if (m_step == 0) {
+        addr = DATA_BASE + (m_i * n + m_k) * ELEM_SIZE;
+        type = READ;
+        m_step = 1;
+      } else if (m_step == 1) {
+        addr = DATA_BASE + array_size + (m_k * n + m_j) * ELEM_SIZE;
+        type = READ;
+        m_step = (++m_k == (int)n) ? 2 : 0;
+      } else {
+        addr = DATA_BASE + 2 * array_size + (m_i * n + m_j) * ELEM_SIZE;
+        type = WRITE;
+        m_step = 0;
+        m_k = 0;
+        if (++m_j == (int)n) {
+          m_j = 0;
+          if (++m_i == (int)n) m_i = 0;
+        }
+      }
+      return addr;
+    }
+    default:
+      assert(false);
+      return 0;
+  }
+}
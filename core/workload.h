@@ -0,0 +1,123 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#include "atom/global.h"
+#include "cache_base/cache_base.h"
+#include "config.h"
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+/// access patterns of the synthetic workload (wl_pattern)
+enum WORKLOAD_PATTERN {
+  WL_SEQUENTIAL = 1,      ///< 8B elements, one after another
+  WL_STRIDED,             ///< fixed stride (wl_stride)
+  WL_RANDOM,              ///< uniform within the footprint
+  WL_POINTER_CHASE,       ///< one line per hop along a random cycle
+  WL_STENCIL,             ///< 5-point 2D stencil, B = f(A), wl_dim x wl_dim doubles
+  WL_MATMUL,              ///< naive ijk C += A * B, wl_dim x wl_dim doubles
+  WL_LAST
+};
+
+/// marker record of a trace ("9 <command>"): region-of-interest control, not an access
+const int TRACE_MARKER = 9;
+
+/// commands of a marker record (its address field)
+enum TRACE_MARKER_COMMAND {
+  MARKER_RESET_STATS = 0,   ///< zero every stat
+  MARKER_ROI_START,         ///< end of the warmup: zero every stat, count from here
+  MARKER_ROI_END,           ///< end of the region of interest: stop the run
+  MARKER_LAST
+};
+
+/**
+ *
+ * @class workload_c
+ *
+ * Stream of memory references that drives the core: one record per call,
+ * in the trace format (type: 0 data read, 1 data write, 2 instruction fetch,
+ * TRACE_MARKER).  A record may carry a gap: the number of non-memory
+ * instructions executed since the previous record, which the core retires
+ * before it issues the record.
+ */
+class workload_c {
+public:
+  virtual ~workload_c() {}
+
+  /// next record; returns false at the end of the workload
+  virtual bool next(int& type, addr_t& address) = 0;
+
+  /// non-memory instructions between the previous record and the last one
+  virtual int get_gap() const { return 0; }
+
+  /// fraction of the workload consumed so far (0..1); negative if unknown
+  virtual double get_progress() { return -1.0; }
+};
+
+/**
+ *
+ * @class trace_workload_c
+ *
+ * Records read from a trace file ("<type> <hex address> [<gap>]" per line;
+ * no gap: 0).
+ */
+class trace_workload_c : public workload_c {
+public:
+  trace_workload_c(const std::string& filename);
+
+  bool is_open() const { return m_file.is_open(); }
+  bool next(int& type, addr_t& address) override;
+  int get_gap() const override { return m_gap; }
+  double get_progress() override;     ///< bytes read so far / file size
+
+private:
+  std::ifstream m_file;
+  std::string m_line;
+  int m_gap;                          ///< gap field of the last record
+  std::streamoff m_size;              ///< file size (-1: not seekable, e.g. a pipe)
+};
+
+/**
+ *
+ * @class synthetic_workload_c
+ *
+ * Generates records for a parameterized access pattern on the fly, so that
+ * the simulator can run without a trace file.  Every instruction is fetched
+ * from a loop of wl_code_size bytes; wl_data_percent of them also access data
+ * according to the pattern, and wl_gap_insts non-memory instructions run
+ * before each fetched one.  The output is fully determined by the config.
+ */
+class synthetic_workload_c : public workload_c {
+public:
+  synthetic_workload_c(const workload_config_s& wc);
+
+  bool next(int& type, addr_t& address) override;
+  int get_gap() const override { return m_gap; }
+  double get_progress() override {
+    return m_config.num_insts ? (double)m_num_insts / m_config.num_insts : -1.0;
+  }
+
+private:
+  addr_t next_data(int& type);        ///< next data access of the pattern
+  int random_type();                  ///< read or write, by wl_write_percent
+
+  workload_config_s m_config;
+  std::mt19937_64 m_rng;
+
+  counter m_num_insts;                ///< instructions generated so far
+  bool m_data_pending;                ///< the last instruction still has to access data
+  int m_gap;                          ///< gap of the last record (wl_gap_insts before each fetch)
+
+  // pattern state
+  counter m_pos;                      ///< sequential/strided offset
+  std::vector<uint32_t> m_chase;      ///< pointer chase: next line of each line
+  uint32_t m_cur;                     ///< pointer chase: current line
+  int m_i, m_j, m_k, m_step;          ///< loop nest indices (stencil, matmul)
+};
+
+#endif // !__WORKLOAD_H__
@@ -10,8 +10,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv) {
-  if (argc != 3) {
-    fprintf(stderr, "[Usage]: %s <trace> <config file>\n", argv[0]);
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr, "[Usage]: %s <trace | synthetic> <config file> [stats file (.json | .csv)]\n", argv[0]);
     return -1;
   }
   
@@ -20,11 +20,26 @@ int main(int argc, char** argv) {
   memory_hierarchy_c* mm = new memory_hierarchy_c(config);
   core_c* m_core = new core_c(mm);
 
-  m_core->run_sim(argv[1]);
+  // "synthetic": generate the workload from the wl_* config keys
+  if (std::string(argv[1]) == "synthetic") {
+    synthetic_workload_c workload(config.get_workload_config());
+    m_core->run_sim(&workload);
+  } else {
+    m_core->run_sim(argv[1]);
+  }
+  mm->m_profiler.stop();
   
+  m_core->print_stats();
   mm->print_stats();
+  mm->m_profiler.print();
+  mm->dump_attribution();
   //mm->dump(true);
 
+  // machine-readable stats (JSON, or CSV for a .csv file name)
+  if (argc == 4 && !mm->dump_stats(argv[3])) {
+    fprintf(stderr, "cannot write stats to %s\n", argv[3]);
+  }
+
   delete mm;
   delete m_core;
   return 0;
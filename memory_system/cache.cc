@@ -2,14 +2,16 @@
 // Lab 4: Memory System Simulation
 
 #include "cache.h"
+#include "parallel_engine.h"
 #include <cstring>
 #include <list>
 #include <cassert>
 #include <iostream>
 #include <cmath>
 
-cache_c::cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency)
-    : cache_base_c(name, num_set, assoc, line_size) {
+cache_c::cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency,
+                 int inclusion, bool lazy_sets, int sample_sets)
+    : cache_base_c(name, num_set, assoc, line_size, lazy_sets, sample_sets) {
 
   // instantiate queues
   m_in_queue   = new queue_c();
@@ -25,15 +27,35 @@ cache_c::cache_c(std::string name, int level, int num_set, int assoc, int line_s
   m_prev_d = nullptr;
   m_next = nullptr;
   m_memory = nullptr;
+  m_victim_cache = nullptr;
+  m_write_buffer = nullptr;
+  m_miss_sent = false;
+  m_write_allocate = true;
+  m_functional = false;
 
   m_latency = latency;
   m_level = level;
+  m_inclusion = inclusion;
 
   // clock cycle
   m_cycle = 0;
   
   m_num_backinvals = 0;
   m_num_writebacks_backinval = 0;
+  m_num_backinv_probes = 0;
+  m_num_backinv_filtered = 0;
+
+  m_num_wb_forwards = 0;
+  m_num_victim_fills = 0;
+  m_num_victim_fills_dirty = 0;
+  m_num_hit_invals = 0;
+
+  m_num_write_throughs = 0;
+  m_num_write_arounds = 0;
+  m_num_store_stalls = 0;
+
+  m_num_fetch_bytes = 0;
+  m_num_wb_bytes = 0;
 }
 
 cache_c::~cache_c() {
@@ -42,7 +64,8 @@ cache_c::~cache_c() {
   delete m_fill_queue;
   delete m_wb_queue;
   delete m_in_flight_wb_queue;
-  delete m_mm;
+  if (m_victim_cache) delete m_victim_cache;
+  if (m_write_buffer) delete m_write_buffer;
 }
 
 /** 
@@ -66,6 +89,31 @@ void cache_c::configure_neighbors(cache_c* prev_i, cache_c* prev_d, cache_c* nex
   m_memory = memory;
 }
 
+void cache_c::attach_victim_cache(int num_entries, int latency) {
+  assert(m_level == MEM_L1 && "a victim cache can only be attached to an L1");
+  assert(m_victim_cache == nullptr);
+  m_victim_cache = new victim_cache_c(m_name + " Victim Cache", num_entries, m_line_size, latency);
+}
+
+void cache_c::attach_write_buffer(int num_entries) {
+  assert(m_write_buffer == nullptr);
+  m_write_buffer = new write_buffer_c(m_name + " Write Buffer", num_entries, m_line_size);
+}
+
+/**
+ * @param write_policy - WRITE_POLICY_BACK or WRITE_POLICY_THROUGH
+ * @param write_allocate - a write miss fetches the line; otherwise (L1 only)
+ *                         the store goes on to the next level and the line
+ *                         is not filled
+ */
+void cache_c::set_write_policy(int write_policy, bool write_allocate) {
+  assert(write_allocate || m_level == MEM_L1);
+  if (write_policy == WRITE_POLICY_THROUGH) {
+    enable_write_through();
+  }
+  m_write_allocate = write_allocate;
+}
+
 /**
  *
  * [Cache Fill Flow]
@@ -78,6 +126,12 @@ void cache_c::configure_neighbors(cache_c* prev_i, cache_c* prev_d, cache_c* nex
  *
  */
 bool cache_c::fill(mem_req_s* req) {
+  // memory runs on its own thread: hand the fill over to the cache thread
+  if (m_mm && m_mm->m_engine && parallel_engine_c::on_memory_thread()) {
+    m_mm->m_engine->send_fill(req);
+    return true;
+  }
+
   req->m_rdy_cycle = m_cycle + m_latency;  // Add the intrinsic cache latency
   m_fill_queue->push(req);        // Put the request into the fill_queue
   return true;
@@ -110,6 +164,8 @@ bool cache_c::access(mem_req_s* req) {
  * 4. on a cache miss, put the current requests into out_queue
  */
 void cache_c::process_in_queue() {
+  profile_scope_c profile(m_mm->m_profiler, PROF_IN_QUEUE);
+
   // if (m_in_queue->empty())
     // return;
   while (!m_in_queue->empty()) { 
@@ -125,34 +181,52 @@ void cache_c::process_in_queue() {
       return;
     }
 
+    // a store that cannot retire into the write buffer holds up the queue
+    if (is_store_blocked(req)) {
+      ++m_num_store_stalls;
+      return;
+    }
+
     m_in_queue->pop(req);
+
+    // set sampling: the set is not simulated
+    if (!is_sampled(req->m_addr)) {
+      process_unsampled(req);
+      continue;
+    }
     
     int access_type = req->m_type; 
     
-    // Write Miss at L2, then read access
-    if(m_level == MEM_L2 && access_type == WRITE){
+    // Write Miss at a lower level (L2, L3, ...), then read access
+    if(m_level != MEM_L1 && access_type == WRITE){
       access_type = READ;
     }
     bool hit = cache_base_c::access(req->m_addr, access_type, false);
 
     // 1. Read(IF) Hit
     // 1.1 (L1 Cache)   => Done
-    // 1.2 (L2) => upper level fill queue
-    // 2. Write Hit => Done
+    // 1.2 (L2, L3, ...) => upper level fill queue
+    // 2. Write Hit => Done (write-through: the data also goes down)
     // 3. Read(IF) or Write Miss => out_queue
 
     // Cache hit
     if (hit) {
       if (m_level == MEM_L1) {
-        done_func(req);
-      } else if (m_level == MEM_L2) {
-        req->m_dirty = false;
-        if (req->m_type == REQ_DFETCH || req->m_type == REQ_DSTORE) {
-          m_prev_d->fill(req);
+        if (req->m_type == WRITE && is_write_through()) {
+          ++m_num_write_throughs;
+          send_write(req);
         }
-        else if (req->m_type == REQ_IFETCH) {
-          m_prev_i->fill(req);
+        m_mm->push_done_req(req);
+      } else {
+        req->m_dirty = false;
+        // exclusive: the line moves up (with its dirty bit) and leaves this level
+        if (m_inclusion == INCL_EXCLUSIVE) {
+          bool dirty;
+          invalidate(req->m_addr, dirty);
+          req->m_dirty = dirty;
+          ++m_num_hit_invals;
         }
+        fill_prev(req);
       }
     }
     // 3. Read(IF) or Write Miss => out_queue
@@ -207,7 +281,7 @@ void cache_c::process_in_queue() {
             }
 
             // common 2: delete req
-            done_func(req);
+            m_mm->push_done_req(req);
             // delete req;
 
             // commmon 1: do not forward out_queue
@@ -216,18 +290,16 @@ void cache_c::process_in_queue() {
           // Nope. Just pure read or write miss
           // Forward to out_queue with missing mark.
           else {
-            req->m_is_miss = true;
-            m_out_queue->push(req);
+            process_l1_miss(req);
           }
         }
         // Nope. Just pure read or write miss
         // Forward to out_queue with missing mark.
         else {
-          req->m_is_miss = true;
-          m_out_queue->push(req);
+          process_l1_miss(req);
         }
       }
-      else { // L2 Cache: just forwarding to out_queue
+      else if (!read_write_buffer(req)) { // Lower level: just forwarding to out_queue
         m_out_queue->push(req);
       }
     }
@@ -240,6 +312,8 @@ void cache_c::process_in_queue() {
  * CURRENT: There is no limit on the number of requests we can process in a cycle.
  */
 void cache_c::process_out_queue() {
+  profile_scope_c profile(m_mm->m_profiler, PROF_OUT_QUEUE);
+
   // if (it == m_out_queue->m_entry.end()) return;
   while (!m_out_queue->empty()) {
     // auto it = m_out_queue->m_entry.begin();
@@ -254,20 +328,21 @@ void cache_c::process_out_queue() {
 
     if (req->m_type == REQ_WB) {
 
-      if (m_level == MEM_L1) {
+      if (m_next) {
         m_next->fill(req);
-      } else if (m_level == MEM_L2) {
-        m_memory->access(req);
+      } else {
+        access_memory(req);
       }
 
     } else if (req->m_type == REQ_DFETCH || req->m_type == REQ_DSTORE || req->m_type == REQ_IFETCH ) { // miss
     // access request to lower level  
-      if (m_level == MEM_L1) {
-        
+      m_miss_sent = true;
+      m_num_fetch_bytes += get_fetch_size();
+      if (m_next) {
         m_next->access(req);
-      } else if (m_level == MEM_L2) {
-        
-        m_memory->access(req);
+      } else {
+        // last-level cache
+        access_memory(req);
       }
     }
     else {
@@ -282,6 +357,8 @@ void cache_c::process_out_queue() {
  */
 
 void cache_c::process_fill_queue() {
+  profile_scope_c profile(m_mm->m_profiler, PROF_FILL_QUEUE);
+
   // if (it == m_fill_queue->m_entry.end()) return;
 
   // if (m_fill_queue->empty())
@@ -305,100 +382,474 @@ void cache_c::process_fill_queue() {
 
   // Fill_1
   if (req->m_type == REQ_WB) {
-    assert(m_level == MEM_L2);
-    // WriteBack to current cache
-    cache_base_c::access(req->m_addr, WRITE_BACK, true);
+    assert(m_level != MEM_L1);
     // Pop WB request from uppder level m_in_flight_wb_queue 
     m_in_flight_wb_queue->pop(req);
+
+    // set sampling: the line is not tracked here; the data stops at this level
+    if (!is_sampled(req->m_addr)) {
+      delete req;
+    }
+    else if (m_inclusion == INCL_EXCLUSIVE) {
+      // exclusive: every upper-level victim (clean or dirty) lands here
+      insert_victim(req->m_addr, req->m_dirty);
+      delete req;
+    }
+    // WriteBack to current cache; if the line is not here (evicted while
+    // the write-back was in flight, or not inclusive), pass the data on
+    else if (cache_base_c::access(req->m_addr, WRITE_BACK, true)) {
+      // write-through: the line stays clean and the data goes on as well
+      if (is_write_through()) {
+        ++m_num_write_throughs;
+        send_wb(req);
+      } else {
+        delete req;
+      }
+    } else {
+      ++m_num_wb_forwards;
+      send_wb(req);
+    }
   }
   // Fill_2
   else {
     if (m_level == MEM_L1) {
-      cache_base_c::access(req->m_addr, req->m_type, true);
-      // if dirty victim has evicted, then write-back to L2
-      if (get_is_evicted_dirty()) {
-        // all L1I cache entry must be clean. 
-        assert (req->m_type != REQ_IFETCH);
-
-        // mem_req_s* wb_req = new
-        addr_t index = (req->m_addr / m_line_size) % m_num_sets;
-        // addr_t offset = req->m_addr % m_line_size;
-        // addr_t wb_req_addr = get_evicted_tag() * m_num_sets * m_line_size + index * m_line_size + offset;
-        addr_t wb_req_addr = get_evicted_addr();
-        mem_req_s* wb_req = new mem_req_s(wb_req_addr, REQ_WB);
-        wb_req->m_id = 424; // WB request from L1 to L2
-        wb_req->m_in_cycle = m_cycle;
-        wb_req->m_rdy_cycle = m_cycle;
-        wb_req->m_done = false;
-        wb_req->m_dirty = true;
-
-        m_wb_queue->push(wb_req);
-        m_next->m_in_flight_wb_queue->push(wb_req);
+      fill_line(req->m_addr, req->m_type, req->m_dirty);
+
+      // write-through: the store merged into the line goes down now
+      if (req->m_type == WRITE && is_write_through()) {
+        ++m_num_write_throughs;
+        send_write(req);
       }
 
-      done_func(req);
+      m_mm->push_done_req(req);
 
-    } else if (m_level == MEM_L2) { // Read(Write) Miss and filled from memory
+    } else { // Read(Write) Miss and filled from the next level
       
-      // First of all, forward to L1 
-      if (req->m_type == REQ_DFETCH || req->m_type == REQ_DSTORE) {
-        m_prev_d->fill(req);
-      }
-      else if (req->m_type == REQ_IFETCH) {
-        m_prev_i->fill(req);
-      }
+      // First of all, forward to the upper level
+      fill_prev(req);
+      fill_line(req->m_addr, req->m_type, req->m_dirty);
+    }
+  }
+  }
+}
 
-      int access_type = req->m_type; 
-  
-      // Write Miss Fill at L2, then read access
-      if(access_type == WRITE){
-        access_type = READ;
-      }
-      cache_base_c::access(req->m_addr, access_type, true);
+/**
+ * Install a line that arrived from the next level (or the victim cache) and
+ * handle the line it replaces.  An exclusive level only passes it up.
+ * @param dirty - (L1) the line comes dirty (from an exclusive level or the
+ *                victim cache)
+ */
+void cache_c::fill_line(addr_t addr, int type, bool dirty) {
+  if (m_level == MEM_L1) {
+    // the line may have reached the victim cache while this fill was in
+    // flight (two misses to the same line); keep a single copy
+    bool vc_dirty;
+    if (m_victim_cache && m_victim_cache->invalidate(addr, vc_dirty)) {
+      dirty = dirty || vc_dirty;
+    }
 
-      // if dirty victim has evicted, then write-back to MEM
-      if (get_is_evicted_dirty()) {
+    // a line handed up by an exclusive level keeps its dirty bit
+    cache_base_c::access(addr, dirty ? WRITE : type, true);
+    process_eviction();
+    if (m_next && m_next->tracks_presence()) {
+      m_next->add_presence(addr, this);
+    }
+    return;
+  }
 
-        addr_t wb_req_addr = get_evicted_addr();
-        mem_req_s* wb_req = new mem_req_s(wb_req_addr, REQ_WB);
-        wb_req->m_id = 4240424; // WB request from L2 to MEM
-        wb_req->m_in_cycle = m_cycle;
-        wb_req->m_rdy_cycle = m_cycle;
-        wb_req->m_done = false;
-        wb_req->m_dirty = true;
+  if (m_next && m_next->tracks_presence()) {
+    m_next->add_presence(addr, this);
+  }
 
-        m_wb_queue->push(wb_req);
-        m_memory->m_in_flight_wb_queue->push(wb_req);
-      }
+  // exclusive: only the upper level is filled
+  if (m_inclusion == INCL_EXCLUSIVE) {
+    return;
+  }
 
-      /**
-       * Back Invalidation Process
-       * 1. if evicted (both clean victim and dirty victim)
-       * 2. check if the evicted block is also in L1
-       * 3. then 
-       * 3-1. invalidate
-       * 3-2. update LRU logic
-       * 4. check if invalidated block is dirty
-       * 4-1. if dirty, write-back to memory directly
-       */
-      if (get_is_evicted()) {
-        // check whether evicted block is also in L1
-        addr_t evicted_addr = get_evicted_addr();
-        bool exist_also_l1d = m_prev_d->cache_base_c::access(evicted_addr, CHECK, false);
-        bool exist_also_l1i = m_prev_i->cache_base_c::access(evicted_addr, CHECK, false);
-
-        // 3. invalidate - L1D
-        if (exist_also_l1d) {
-          m_prev_d->back_inv(evicted_addr, "L1D");
-        }
-        // 3. invalidate - L1I
-        if (exist_also_l1i) {
-          m_prev_i->back_inv(evicted_addr, "L1I");
-        }
-      }
+  // Write Miss Fill at a lower level, then read access
+  cache_base_c::access(addr, (type == WRITE) ? READ : type, true);
+  process_eviction();
+}
+
+/**
+ * Functional mode: a demand access (from the core at L1, or a miss of the
+ * level above) served at once, with no queues, cycles or requests.  The
+ * steps are those of the timing model with a single request in flight
+ * (single_request = 1): the lookup; on a miss the next level, then the fill
+ * here.  A write-back reaches the next level after the access is done but
+ * before the next one gets there, so it is absorbed in between
+ * (write_back_func).  The cache stats are those of that timing run.
+ * @return the line comes dirty (from an exclusive level or the victim cache)
+ */
+bool cache_c::access_func(addr_t addr, int type) {
+  // set sampling: answered as a hit, with no traffic below
+  if (!is_sampled(addr)) {
+    ++m_num_unsampled;
+    return false;
+  }
+
+  // Write Miss at a lower level (L2, L3, ...), then read access
+  int access_type = (m_level != MEM_L1 && type == WRITE) ? READ : type;
+  if (cache_base_c::access(addr, access_type, false)) {
+    bool dirty = false;
+    // exclusive: the line moves up (with its dirty bit) and leaves this level
+    if (m_level != MEM_L1 && m_inclusion == INCL_EXCLUSIVE) {
+      invalidate(addr, dirty);
+      ++m_num_hit_invals;
     }
+    return dirty;
   }
+
+  bool dirty = false;
+  if (!(m_victim_cache && m_victim_cache->probe(addr, dirty))) {
+    m_num_fetch_bytes += get_fetch_size();
+    if (m_next) {
+      dirty = m_next->access_func(addr, type);
+    }
   }
+  fill_line(addr, type, dirty);
+  return dirty;
+}
+
+/**
+ * Functional mode: a write-back (or a clean victim) from the level above,
+ * as in the write-back case of process_fill_queue.
+ */
+void cache_c::write_back_func(addr_t addr, bool dirty) {
+  if (!is_sampled(addr)) {
+    return;
+  }
+  if (m_inclusion == INCL_EXCLUSIVE) {
+    insert_victim(addr, dirty);
+    return;
+  }
+  if (cache_base_c::access(addr, WRITE_BACK, true)) {
+    if (!is_write_through()) {
+      return;
+    }
+    ++m_num_write_throughs;
+  } else {
+    ++m_num_wb_forwards;
+  }
+  if (m_next) {
+    m_next->write_back_func(addr, dirty);
+  }
+}
+
+/**
+ * Handle the victim of the fill that was just performed.
+ * 0. L1 with a victim cache: insert the victim there; continue with the line
+ *    it displaces (if any)
+ * 1. dirty victim: write-back to the next level
+ * 2. clean victim: also sent down if the next level is exclusive
+ * 3. Back Invalidation Process (inclusive levels only)
+ * 3-1. if evicted (both clean victim and dirty victim)
+ * 3-2. check if the evicted block is also in the upper levels
+ * 3-3. invalidate + update LRU logic
+ * 3-4. if the invalidated block is dirty, write-back to memory directly
+ */
+void cache_c::process_eviction() {
+  if (!get_is_evicted()) {
+    return;
+  }
+  addr_t evicted_addr = get_evicted_addr();
+  bool dirty = get_is_evicted_dirty();
+  int dirty_bytes = get_evicted_dirty_bytes();
+  int presence = get_evicted_presence();
+
+  // the victim cache catches the line; only what it displaces leaves the level
+  if (m_victim_cache) {
+    victim_entry_s displaced;
+    if (!m_victim_cache->insert(evicted_addr, dirty, displaced)) {
+      return;
+    }
+    evicted_addr = displaced.m_addr;
+    dirty = displaced.m_dirty;
+    dirty_bytes = dirty ? m_line_size : 0;
+  }
+
+  evict_line(evicted_addr, dirty, dirty_bytes, presence);
+}
+
+/**
+ * A line leaves this level (L1 plus its victim cache, or a lower level).
+ * @param dirty_bytes - bytes written back (the dirty sectors of a sectored line)
+ * @param presence - (inclusive) presence bits of the line: the upper-level
+ *                   caches to back-invalidate
+ */
+void cache_c::evict_line(addr_t evicted_addr, bool dirty, int dirty_bytes, int presence) {
+  if (dirty) {
+    m_num_wb_bytes += dirty_bytes;
+    send_line(evicted_addr, true, (m_level == MEM_L1) ? 424 : 4240424);
+  } else if (m_next && m_next->get_inclusion() == INCL_EXCLUSIVE) {
+    send_line(evicted_addr, false, 425);  // clean victim
+  }
+
+  if (m_level != MEM_L1 && m_inclusion == INCL_INCLUSIVE) {
+    back_inv_prev(evicted_addr, m_line_size, presence);
+  }
+
+  // the line is gone from here and, at the top or an inclusive level, from
+  // everything above
+  if (m_next && m_next->tracks_presence() && (m_level == MEM_L1 || m_inclusion == INCL_INCLUSIVE)) {
+    m_next->remove_presence(evicted_addr, this);
+  }
+}
+
+/**
+ * L1 miss that is not already in flight.
+ * 1. victim cache hit: swap the line back into the L1; the data is ready after
+ *    the victim cache latency and takes the normal L1 fill path, where the
+ *    line it replaces goes into the victim cache
+ * 2. no-write-allocate store: the data goes down and the store is done; no
+ *    line is filled
+ * 3. otherwise: forward to the next level (out_queue) with a missing mark
+ */
+void cache_c::process_l1_miss(mem_req_s* req) {
+  // in flight from now on: later misses to the address merge with this one
+  req->m_is_miss = true;
+
+  bool dirty;
+  if (m_victim_cache && m_victim_cache->probe(req->m_addr, dirty)) {
+    req->m_dirty = dirty;
+    req->m_rdy_cycle = m_cycle + m_victim_cache->get_latency();
+    m_fill_queue->push(req);
+    return;
+  }
+
+  if (req->m_type == WRITE && !m_write_allocate) {
+    req->m_is_miss = false;  // nothing comes back to merge with
+    ++m_num_write_arounds;
+    send_write(req);
+    m_mm->push_done_req(req);
+    return;
+  }
+
+  if (read_write_buffer(req)) {
+    return;
+  }
+
+  m_out_queue->push(req);
+}
+
+/**
+ * Set sampling: a request to an unsampled set skips the tag store and is
+ * answered by this level as a hit after the normal latency, so it generates
+ * no traffic below.  The timing of those requests is therefore optimistic;
+ * only the scaled stats of the sampled sets are meant to be read.
+ */
+void cache_c::process_unsampled(mem_req_s* req) {
+  ++m_num_unsampled;
+  if (m_level == MEM_L1) {
+    m_mm->push_done_req(req);
+  } else {
+    req->m_dirty = false;
+    fill_prev(req);
+  }
+}
+
+/**
+ * A miss to a line whose write-back is still buffered here reads the data
+ * from the buffer: it takes the normal fill path right away.  The buffered
+ * write-back is kept and drains as usual, so the refilled line is clean.
+ */
+bool cache_c::read_write_buffer(mem_req_s* req) {
+  if (!m_write_buffer || !m_write_buffer->find(req->m_addr)) {
+    return false;
+  }
+
+  m_write_buffer->count_read_hit();
+  req->m_dirty = false;
+  req->m_rdy_cycle = m_cycle;
+  m_fill_queue->push(req);
+  return true;
+}
+
+/**
+ * (L1) A store whose data has to go down right away (a write-through hit or
+ * a write miss that does not allocate) retires into the write buffer.  While
+ * the buffer is full and holds nothing for the line, the store waits at the
+ * head of the in_queue, and so do the requests behind it.  Without a write
+ * buffer nothing waits; a store that misses and allocates writes its data
+ * when the line arrives.
+ */
+bool cache_c::is_store_blocked(mem_req_s* req) {
+  if (m_level != MEM_L1 || req->m_type != WRITE || !m_write_buffer || !m_write_buffer->full() ||
+      !is_sampled(req->m_addr) || m_write_buffer->find(req->m_addr)) {
+    return false;
+  }
+  if (cache_base_c::access(req->m_addr, CHECK, false)) {
+    return is_write_through();
+  }
+  return !m_write_allocate && !m_mm->is_repeated_miss_req(req);
+}
+
+/**
+ * Pass the data of a store on to the next level.  It travels like the
+ * write-back of its line (through the write buffer, where it may coalesce)
+ * and is absorbed by the first level below that holds the line.
+ */
+void cache_c::send_write(mem_req_s* req) {
+  send_wb(create_wb_req(req->m_addr, 426));
+}
+
+/**
+ * (exclusive) Install a victim from the upper level.  This is not an access:
+ * no hit/miss statistics are updated.  The line may already be here if both
+ * L1I and L1D held it; then only its dirty bit is merged.
+ */
+void cache_c::insert_victim(addr_t addr, bool dirty) {
+  bool hit = cache_base_c::access(addr, CHECK, false);
+
+  if (hit) {
+    if (dirty) {
+      cache_base_c::access(addr, WRITE_BACK, true);
+    }
+  } else {
+    ++m_num_victim_fills;
+    if (dirty) ++m_num_victim_fills_dirty;
+
+    cache_base_c::access(addr, dirty ? WRITE : READ, true);
+    process_eviction();
+  }
+}
+
+/**
+ * (inclusive) upper filled a line of addr: from now on it may hold the line.
+ */
+void cache_c::add_presence(addr_t addr, cache_c* upper) {
+  cache_entry_c* entry = find_line(addr);
+  if (entry) {
+    entry->m_presence |= get_presence_bit(upper);
+  }
+}
+
+/**
+ * (inclusive) A line of addr left upper and every level above it.  If lines
+ * here are larger, the bit stays while upper holds another part of the line.
+ */
+void cache_c::remove_presence(addr_t addr, cache_c* upper) {
+  cache_entry_c* entry = find_line(addr);
+  int bit = get_presence_bit(upper);
+  if (!entry || !(entry->m_presence & bit)) {
+    return;
+  }
+  if (upper->m_line_size < m_line_size && upper->holds_line(addr / m_line_size * m_line_size, m_line_size)) {
+    return;
+  }
+  entry->m_presence &= ~bit;
+}
+
+/**
+ * Is a line of [addr, addr + size) here (or in the victim cache)?  addr is
+ * aligned to this level's line size.
+ */
+bool cache_c::holds_line(addr_t addr, int size) {
+  for (addr_t line = addr; line < addr + size; line += m_line_size) {
+    if (find_line(line) || (m_victim_cache && m_victim_cache->contains(line))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Forward a fill (or a hit) to the upper level that requested it.  With a
+ * unified upper level, m_prev_i and m_prev_d point to the same cache.
+ */
+void cache_c::fill_prev(mem_req_s* req) {
+  if (req->m_type == REQ_IFETCH) {
+    m_prev_i->fill(req);
+  } else {
+    m_prev_d->fill(req);
+  }
+}
+
+/**
+ * Back-invalidate a line (of size bytes) in the upper-level caches whose
+ * presence bit is set (PRESENCE_ALL: every one); the others cannot hold it.
+ */
+void cache_c::back_inv_prev(addr_t back_inv_addr, int size, int presence) {
+  if (presence & PRESENCE_D) {
+    ++m_num_backinv_probes;
+    m_prev_d->back_inv(back_inv_addr, size);
+  } else {
+    ++m_num_backinv_filtered;
+  }
+  if (m_prev_i != m_prev_d) {
+    if (presence & PRESENCE_I) {
+      ++m_num_backinv_probes;
+      m_prev_i->back_inv(back_inv_addr, size);
+    } else {
+      ++m_num_backinv_filtered;
+    }
+  }
+}
+
+/**
+ * Create a write-back request for an evicted line.
+ */
+mem_req_s* cache_c::create_wb_req(addr_t wb_addr, uint32_t id) {
+  mem_req_s* wb_req = new mem_req_s(wb_addr, REQ_WB);
+  wb_req->m_id = id;
+  wb_req->m_in_cycle = m_cycle;
+  wb_req->m_rdy_cycle = m_cycle;
+  wb_req->m_done = false;
+  wb_req->m_dirty = true;
+  return wb_req;
+}
+
+/**
+ * Send a line leaving this level down: a write-back, or (dirty == false) a
+ * clean victim for an exclusive next level.  In functional mode the next
+ * level takes it before the next demand access (see
+ * memory_hierarchy_c::drain_functional).
+ */
+void cache_c::send_line(addr_t addr, bool dirty, uint32_t id) {
+  if (m_functional) {
+    if (m_next) m_mm->push_functional_wb(m_next, addr, dirty);
+    return;
+  }
+  mem_req_s* wb_req = create_wb_req(addr, id);
+  wb_req->m_dirty = dirty;
+  send_wb(wb_req);
+}
+
+/**
+ * Queue a write-back to the next level (or main memory) and account it as
+ * in flight there until it is absorbed.
+ */
+void cache_c::send_wb(mem_req_s* wb_req) {
+  if (m_write_buffer) {
+    // merge into a buffered write-back to the same line
+    mem_req_s* pending = m_write_buffer->find(wb_req->m_addr);
+    if (pending) {
+      m_write_buffer->coalesce(pending, wb_req);
+      delete wb_req;
+      return;
+    }
+    // full: the oldest line has to go now, idle or not
+    if (m_write_buffer->full()) {
+      m_wb_queue->push(m_write_buffer->pop(true));
+    }
+    m_write_buffer->push(wb_req);
+  } else {
+    m_wb_queue->push(wb_req);
+  }
+
+  if (m_next) {
+    m_next->m_in_flight_wb_queue->push(wb_req);
+  } else {
+    track_memory_wb(wb_req);
+  }
+}
+
+/**
+ * The write buffer drains only when it does not compete with demand misses:
+ * nothing was sent to the next level in the previous cycle.
+ */
+bool cache_c::is_next_level_idle() {
+  return !m_miss_sent;
 }
 
 /**
@@ -408,60 +859,85 @@ void cache_c::process_fill_queue() {
  * 3-2. update LRU logic
  * 4. check if invalidated block is dirty
  * 4-1. if dirty, write-back to memory directly
+ * 5. repeat for the levels above this one
+ *
+ * The lower level may use larger lines than this one: every line of this
+ * level within [back_inv_addr, back_inv_addr + size) goes.
  */
-void cache_c::back_inv(addr_t back_inv_addr, std::string cache_info) {
-  assert (m_level == MEM_L1);
-  assert (cache_info == "L1D" || cache_info == "L1I");
-
-  ++m_num_backinvals;
-
-  int tag = back_inv_addr / (m_num_sets * m_line_size);
-  int set_index = (back_inv_addr / m_line_size) % m_num_sets;
+void cache_c::back_inv(addr_t back_inv_addr, int size) {
+  int presence = 0;
+  addr_t begin = back_inv_addr / m_line_size * m_line_size;
+  for (addr_t addr = begin; addr < back_inv_addr + size; addr += m_line_size) {
+    // (inclusive) only the caches above that hold the line can hold it
+    if (tracks_presence()) {
+      cache_entry_c* entry = find_line(addr);
+      if (entry) {
+        presence |= entry->m_presence;
+      } else if (!is_sampled(addr)) {
+        presence = PRESENCE_ALL;  // not tracked here
+      }
+    }
 
-  cache_set_c* set = m_set_list[set_index];
+    // invalidate + update LRU
+    bool dirty;
+    int dirty_bytes = get_dirty_bytes(addr);
+    if (invalidate(addr, dirty)) {
+      ++m_num_backinvals;
 
-  // Check if there is a cache hit
-  bool hit = false;
-  int hit_index = -1;
+      // if dirty, write back to memory directly
+      if (dirty) {
+        ++m_num_writebacks_backinval;
+        m_num_wb_bytes += dirty_bytes;
+        write_back_memory(addr); // Direct WB_backinv request to MEM
+      }
+    }
+    // the victim cache counts as part of the L1
+    if (m_victim_cache && m_victim_cache->invalidate(addr, dirty)) {
+      ++m_num_backinvals;
 
-  for (int i = 0; i < set->m_assoc; ++i) {
-    if (set->m_entry[i].m_valid && set->m_entry[i].m_tag == tag) {
-      hit = true;
-      hit_index = i;
-      break;
+      if (dirty) {
+        ++m_num_writebacks_backinval;
+        m_num_wb_bytes += m_line_size;
+        write_back_memory(addr); // Direct WB_backinv request to MEM
+      }
     }
   }
 
-  // all L1I cache entry must be clean. 
-  if (cache_info == "L1I") {
-    assert (!set->m_entry[hit_index].m_dirty);
+  // an upper level may hold the line even if this one does not (non-inclusive)
+  if (m_prev_d) {
+    back_inv_prev(back_inv_addr, size, tracks_presence() ? presence : PRESENCE_ALL);
   }
+}
 
-  if (hit) {
-    // if dirty, write back to memory directly
-    if (set->m_entry[hit_index].m_dirty) {
-      ++m_num_writebacks_backinval;
-      // write back to memory directly
-      mem_req_s* mem_wb_req = new mem_req_s(back_inv_addr, REQ_WB);
-      mem_wb_req->m_id = 1537; // Direct WB_backinv request from L2 to MEM
-      mem_wb_req->m_in_cycle = m_cycle;
-      mem_wb_req->m_rdy_cycle = m_cycle;
-      mem_wb_req->m_done = false;
-      mem_wb_req->m_dirty = true;
-      m_memory->access(mem_wb_req);
-    }
-
-    // invalid
-    set->m_entry[hit_index].m_valid = false;
-    set->m_entry[hit_index].m_dirty = false;
-    set->m_entry[hit_index].m_tag = 0;
+/**
+ * Write a back-invalidated dirty line straight to main memory.  In
+ * functional mode main memory is not modeled.
+ */
+void cache_c::write_back_memory(addr_t addr) {
+  if (!m_functional) {
+    access_memory(create_wb_req(addr, 1537));
+  }
+}
 
-    // update LRU
-    set->m_lru_stack.remove(&set->m_entry[hit_index]);
+/**
+ * Send a request to main memory, through the parallel engine if it is running.
+ */
+void cache_c::access_memory(mem_req_s* req) {
+  if (m_mm->m_engine) {
+    m_mm->m_engine->send_to_memory(req);
+  } else {
+    m_memory->access(req);
   }
-  // never goes into this
-  else {
-    assert(false);
+}
+
+/**
+ * Account a write-back to main memory as in flight before it is sent.
+ */
+void cache_c::track_memory_wb(mem_req_s* req) {
+  if (m_mm->m_engine) {
+    m_mm->m_engine->track_wb(req);
+  } else {
+    m_memory->m_in_flight_wb_queue->push(req);
   }
 }
 
@@ -471,6 +947,8 @@ void cache_c::back_inv(addr_t back_inv_addr, std::string cache_info) {
  * CURRENT: There is no limit on the number of requests we can process in a cycle.
  */
 void cache_c::process_wb_queue() {
+  profile_scope_c profile(m_mm->m_profiler, PROF_WB_QUEUE);
+
   // \TODO: Implement this function
   // auto it = m_wb_queue->m_entry.begin();
   // if (it == m_wb_queue->m_entry.end()) return;
@@ -479,6 +957,16 @@ void cache_c::process_wb_queue() {
 
   // // move to output queue
   // m_out_queue->push(req);
+
+  // write buffer: drain one line per cycle while the next level is idle
+  if (m_write_buffer) {
+    m_write_buffer->tick();
+    if (!m_write_buffer->empty() && is_next_level_idle()) {
+      m_wb_queue->push(m_write_buffer->pop(false));
+    }
+  }
+  m_miss_sent = false;
+
   while (!m_wb_queue->empty())
   {
     mem_req_s *req = m_wb_queue->m_entry.front();
@@ -494,4 +982,154 @@ void cache_c::print_stats() {
   cache_base_c::print_stats();
   std::cout << "number of back invalidations: " << m_num_backinvals << "\n";
   std::cout << "number of writebacks due to back invalidations: " << m_num_writebacks_backinval << "\n";
+  if (tracks_presence()) {
+    std::cout << "number of back invalidation probes: " << m_num_backinv_probes << "\n";
+    std::cout << "number of back invalidation probes filtered: " << m_num_backinv_filtered << "\n";
+  }
+
+  // inclusion-policy specific counters (lower levels only)
+  if (m_level != MEM_L1 && m_inclusion == INCL_NON_INCLUSIVE) {
+    std::cout << "number of writebacks passed to the next level: " << m_num_wb_forwards << "\n";
+  } else if (m_level != MEM_L1 && m_inclusion == INCL_EXCLUSIVE) {
+    std::cout << "number of victim fills: " << m_num_victim_fills << "\n";
+    std::cout << "number of dirty victim fills: " << m_num_victim_fills_dirty << "\n";
+    std::cout << "number of invalidations on hit: " << m_num_hit_invals << "\n";
+  }
+
+  // write-policy specific counters
+  if (is_write_through()) {
+    std::cout << "number of write-throughs: " << m_num_write_throughs << "\n";
+  }
+  if (!m_write_allocate) {
+    std::cout << "number of write misses not allocated: " << m_num_write_arounds << "\n";
+  }
+  if (m_level == MEM_L1 && m_write_buffer && (is_write_through() || !m_write_allocate)) {
+    std::cout << "number of store stall cycles (write buffer full): " << m_num_store_stalls << "\n";
+  }
+
+  if (is_sectored()) {
+    std::cout << "number of sector misses: " << get_num_sector_misses() << "\n";
+    std::cout << "number of bytes fetched: " << m_num_fetch_bytes << "\n";
+    std::cout << "number of bytes written back: " << m_num_wb_bytes << "\n";
+  }
+
+  if (is_lazy()) {
+    std::cout << "number of allocated sets: " << get_num_allocated_sets() << " / " << m_num_sets << "\n";
+  }
+
+  print_sampling_stats();
+  print_partition_stats();
+  if (get_miss_classifier()) {
+    get_miss_classifier()->print_stats(std::cout, m_name);
+  }
+  if (get_attribution()) {
+    get_attribution()->print_report(std::cout, m_name);
+  }
+
+  if (m_victim_cache) {
+    m_victim_cache->print_stats();
+  }
+  if (m_write_buffer) {
+    m_write_buffer->print_stats();
+  }
+}
+
+void cache_c::reset_stats() {
+  cache_base_c::reset_stats();
+
+  m_num_backinvals = 0;
+  m_num_writebacks_backinval = 0;
+  m_num_backinv_probes = 0;
+  m_num_backinv_filtered = 0;
+  m_num_wb_forwards = 0;
+  m_num_victim_fills = 0;
+  m_num_victim_fills_dirty = 0;
+  m_num_hit_invals = 0;
+  m_num_write_throughs = 0;
+  m_num_write_arounds = 0;
+  m_num_store_stalls = 0;
+  m_num_fetch_bytes = 0;
+  m_num_wb_bytes = 0;
+
+  if (m_victim_cache) m_victim_cache->reset_stats();
+  if (m_write_buffer) m_write_buffer->reset_stats();
+}
+
+/**
+ * Register the statistics of this cache (and its victim cache / write buffer)
+ * under "<prefix>.".
+ */
+void cache_c::register_stats(stats_registry_c& stats, const std::string& prefix) {
+  cache_base_c::register_stats(stats, prefix);
+  stats.add_counter(prefix + ".back_invalidations", &m_num_backinvals);
+  stats.add_counter(prefix + ".writebacks_backinval", &m_num_writebacks_backinval);
+  if (tracks_presence()) {
+    stats.add_counter(prefix + ".backinv_probes", &m_num_backinv_probes);
+    stats.add_counter(prefix + ".backinv_filtered", &m_num_backinv_filtered);
+  }
+
+  if (m_level != MEM_L1 && m_inclusion == INCL_NON_INCLUSIVE) {
+    stats.add_counter(prefix + ".writebacks_forwarded", &m_num_wb_forwards);
+  } else if (m_level != MEM_L1 && m_inclusion == INCL_EXCLUSIVE) {
+    stats.add_counter(prefix + ".victim_fills", &m_num_victim_fills);
+    stats.add_counter(prefix + ".victim_fills_dirty", &m_num_victim_fills_dirty);
+    stats.add_counter(prefix + ".hit_invalidations", &m_num_hit_invals);
+  }
+
+  if (is_write_through()) {
+    stats.add_counter(prefix + ".write_throughs", &m_num_write_throughs);
+  }
+  if (!m_write_allocate) {
+    stats.add_counter(prefix + ".write_arounds", &m_num_write_arounds);
+  }
+  if (m_level == MEM_L1 && m_write_buffer && (is_write_through() || !m_write_allocate)) {
+    stats.add_counter(prefix + ".store_stall_cycles", &m_num_store_stalls);
+  }
+
+  if (is_sectored()) {
+    stats.add_counter(prefix + ".sector_misses", &m_num_sector_misses);
+    stats.add_counter(prefix + ".fetch_bytes", &m_num_fetch_bytes);
+    stats.add_counter(prefix + ".writeback_bytes", &m_num_wb_bytes);
+  }
+
+  if (m_victim_cache) {
+    m_victim_cache->register_stats(stats, prefix + ".victim_cache");
+  }
+  if (m_write_buffer) {
+    m_write_buffer->register_stats(stats, prefix + ".write_buffer");
+  }
+}
+
+int cache_c::get_num_lines() const {
+  int num_lines = m_num_sets * m_assoc;
+  if (m_victim_cache) num_lines += m_victim_cache->get_num_entries();
+  return num_lines;
+}
+
+/**
+ * Append the address of every valid line in this cache, in units of
+ * unit_size bytes (a line of this cache counts line_size / unit_size times).
+ */
+void cache_c::count_lines(std::vector<addr_t>& lines, int unit_size) {
+  int units = m_line_size / unit_size;
+  size_t first = lines.size();
+  for (int ii = 0; ii < m_num_sets; ++ii) {
+    cache_set_c* set = find_set(ii);
+    for (int jj = 0; set && jj < set->m_assoc; ++jj) {
+      cache_entry_c* entry = &set->m_entry[jj];
+      if (entry->m_valid) {
+        lines.push_back(((addr_t)entry->m_tag * m_num_sets + ii) * m_line_size);
+      }
+    }
+  }
+  if (m_victim_cache) {
+    m_victim_cache->count_lines(lines);
+  }
+
+  if (units > 1) {
+    size_t last = lines.size();
+    for (size_t ii = first; ii < last; ++ii) {
+      for (int uu = 1; uu < units; ++uu) lines.push_back(lines[ii] + uu * unit_size);
+    }
+  }
 }
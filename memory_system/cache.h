@@ -10,33 +10,62 @@
 #include "./cache_base/cache_base.h"
 #include "memory_controller/simple_mem.h"
 #include "memory_hierarchy.h"
+#include "victim_cache.h"
+#include "write_buffer.h"
 
 #include <cstring>
-#include <functional>
+#include <vector>
 
 // forward declaration
 class simple_mem_c;
 class memory_hierarchy_c;
 
+/// inclusion policy of a lower-level cache w.r.t. the levels above it
+enum INCLUSION_POLICY {
+  INCL_INCLUSIVE = 0,     ///< evictions back-invalidate the upper levels
+  INCL_NON_INCLUSIVE,     ///< no back-invalidation
+  INCL_EXCLUSIVE,         ///< filled only by upper-level victims; a hit moves the line up
+  INCL_LAST
+};
+
+/// way partitioning between instruction and data lines (<prefix>_way_partition)
+enum WAY_PARTITION {
+  PARTITION_NONE = 0,     ///< any fill may replace any way
+  PARTITION_FIXED,        ///< fixed way masks (<prefix>_inst_way_mask, <prefix>_data_way_mask)
+  PARTITION_UTILITY,      ///< repartitioned from shadow-tag hits every <prefix>_partition_interval accesses
+  PARTITION_LAST
+};
+
+/// when a write reaches the next level (<prefix>_write_policy)
+enum WRITE_POLICY {
+  WRITE_POLICY_BACK = 0,  ///< when the dirty line is evicted
+  WRITE_POLICY_THROUGH,   ///< right away; lines are never dirty
+  WRITE_POLICY_LAST
+};
+
 
 class cache_c : public cache_base_c {
 
 public:
-  cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency);
+  cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency,
+          int inclusion = INCL_INCLUSIVE, bool lazy_sets = false, int sample_sets = 1);
   void configure_neighbors(cache_c* prev_i, cache_c* prev_d, cache_c* next, simple_mem_c* memory);
+  void attach_victim_cache(int num_entries, int latency);  ///< (L1 only) add a victim cache
+  void attach_write_buffer(int num_entries);               ///< add a write buffer
+  void set_write_policy(int write_policy, bool write_allocate);  ///< (see WRITE_POLICY)
   void run_a_cycle();             ///< tick a cycle
                                   
   bool access(mem_req_s*);        ///< insert a request into in_queue
   bool fill(mem_req_s*);          ///< insert a request into fill_queue
+
+  // functional mode (no queues, cycles or requests; see access_func)
+  void set_functional() { m_functional = true; }
+  bool access_func(addr_t addr, int type);        ///< a demand access, served at once
+  void write_back_func(addr_t addr, bool dirty);  ///< a line from the level above, absorbed at once
   
   void print_stats(void);
-
-  // callback for done requests
-public:
-  using callback_t = std::function<void(mem_req_s*)>;
-
-  callback_t done_func;              
-  void set_done_func(callback_t cb) { done_func = std::move(cb); }
+  void reset_stats();
+  void register_stats(stats_registry_c& stats, const std::string& prefix);
 
 private:
   void process_in_queue();        ///< process requests from in_queue
@@ -45,20 +74,48 @@ private:
   void process_wb_queue();        ///< process requests from wb_queue
 
   // for write-back evicted cache line 
-  mem_req_s* create_wb_req(addr_t evicted_tag, mem_req_s* req);
+  mem_req_s* create_wb_req(addr_t wb_addr, uint32_t id);
+  void send_wb(mem_req_s* wb_req);      ///< write-back to the next level
+  void send_line(addr_t addr, bool dirty, uint32_t id);  ///< a write-back or clean victim to the next level
+  void write_back_memory(addr_t addr);  ///< a back-invalidated dirty line to main memory
+
+  void fill_prev(mem_req_s* req);       ///< forward data to the upper level
+  void process_l1_miss(mem_req_s* req); ///< probe the victim cache, then go to the next level
+  void process_unsampled(mem_req_s* req);  ///< (set sampling) serve a request without a lookup
+  bool read_write_buffer(mem_req_s* req);  ///< serve a miss from the write buffer
+  bool is_store_blocked(mem_req_s* req);   ///< (L1) a store waits for a full write buffer
+  void send_write(mem_req_s* req);      ///< pass the data of a store on to the next level
+  bool is_next_level_idle();            ///< no demand traffic towards the next level
+  void fill_line(addr_t addr, int type, bool dirty);  ///< install a line from below
+  void process_eviction();              ///< handle the victim of the last fill
+  void evict_line(addr_t evicted_addr, bool dirty, int dirty_bytes, int presence);  ///< send a line leaving this level down
+  void insert_victim(addr_t addr, bool dirty);  ///< (exclusive) install an upper-level victim
+  void back_inv_prev(addr_t back_inv_addr, int size, int presence);
+
+  // presence bits (inclusive levels): which upper-level caches may hold a line
+  enum { PRESENCE_D = 1, PRESENCE_I = 2, PRESENCE_ALL = 3 };
+  bool tracks_presence() const { return m_level != MEM_L1 && m_inclusion == INCL_INCLUSIVE; }
+  int get_presence_bit(const cache_c* upper) const { return (upper == m_prev_d) ? PRESENCE_D : PRESENCE_I; }
+  void add_presence(addr_t addr, cache_c* upper);     ///< upper filled a line of addr
+  void remove_presence(addr_t addr, cache_c* upper);  ///< a line of addr left upper (and everything above it)
+  bool holds_line(addr_t addr, int size);             ///< a line of [addr, addr + size) is here (incl. victim cache)
+
+  void access_memory(mem_req_s* req);   ///< send a request to main memory
+  void track_memory_wb(mem_req_s* req); ///< mark a write-back to memory as in flight
 
 public:
   queue_c* m_in_flight_wb_queue;  ///< in-flight write-back queue
   counter m_cycle;                ///< clock cycle                         
 
-  void back_inv(addr_t back_inv_addr, std::string cache_info);
+  void back_inv(addr_t back_inv_addr, int size);  ///< invalidate [addr, addr + size) here and above
   
   memory_hierarchy_c* m_mm;
 private:
 
   int m_id;                       ///< cache id
-  int m_level;                    ///< cache level (L1, L2) 
+  int m_level;                    ///< cache level (1: L1, 2: L2, 3: L3, ...)
   int m_latency;                  ///< cache hit latency (intrinsic access time)
+  int m_inclusion;                ///< inclusion policy (INCLUSION_POLICY)
   
   queue_c* m_in_queue;            ///< input queue 
   queue_c* m_out_queue;           ///< out queue 
@@ -66,12 +123,37 @@ private:
   queue_c* m_wb_queue;            ///< write-back queue
 
   cache_c* m_prev_i;              ///< previous I-cache level pointer
-  cache_c* m_prev_d;              ///< previous D-cache level pointer
+  cache_c* m_prev_d;              ///< previous D-cache level pointer (== m_prev_i if unified)
   cache_c* m_next;                ///< next cache level potiner
   simple_mem_c* m_memory;         ///< main memory pointer
+  victim_cache_c* m_victim_cache; ///< victim cache (L1 only; nullptr if none)
+  write_buffer_c* m_write_buffer; ///< write buffer (nullptr if none)
+  bool m_miss_sent;               ///< a miss went to the next level in the last cycle
+  bool m_write_allocate;          ///< a write miss fetches the line (L1)
+  bool m_functional;              ///< functional mode: only access_func/write_back_func are used
   
-  int m_num_backinvals;                ///< # of back-invalidations
-  int m_num_writebacks_backinval;      ///< # of writebacks due to back-invalidation
+  counter m_num_backinvals;            ///< # of back-invalidations
+  counter m_num_writebacks_backinval;  ///< # of writebacks due to back-invalidation
+  counter m_num_backinv_probes;        ///< # of back-invalidations sent to an upper-level cache
+  counter m_num_backinv_filtered;      ///< # of those skipped: no presence bit
+
+  counter m_num_wb_forwards;           ///< # of write-backs that missed and went to the next level
+  counter m_num_victim_fills;          ///< (exclusive) # of upper-level victims installed
+  counter m_num_victim_fills_dirty;    ///< (exclusive) # of those that were dirty
+  counter m_num_hit_invals;            ///< (exclusive) # of lines moved up on a hit
+
+  counter m_num_write_throughs;        ///< (write-through) # of writes passed on to the next level
+  counter m_num_write_arounds;         ///< (no-write-allocate) # of write misses passed on instead
+  counter m_num_store_stalls;          ///< (L1) # of cycles a store waited for a full write buffer
+
+  counter m_num_fetch_bytes;           ///< bytes requested from the next level (sectored: sectors only)
+  counter m_num_wb_bytes;              ///< bytes written back (sectored: dirty sectors only)
+
+public:
+  int get_inclusion() const { return m_inclusion; }
+  bool is_write_allocate() const { return m_write_allocate; }
+  int get_num_lines() const;                     ///< capacity in lines (incl. the victim cache)
+  void count_lines(std::vector<addr_t>& lines, int unit_size);  ///< append every valid line, in unit_size pieces
 
 public:
   cache_c();               // no need to implement
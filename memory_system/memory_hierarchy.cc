@@ -3,7 +3,7 @@
 
 /**
  *
- * @class memory_hierarchy_c 
+ * @class memory_hierarchy_c
  *
  * This models the memory hierarchy in the processor. When the constructor is
  * called, the init() function initialize the cache/main memory components in
@@ -13,103 +13,279 @@
 
 #include "memory_hierarchy.h"
 #include "cache.h"
+#include "parallel_engine.h"
+#include "mmu.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <iostream>
 
 memory_hierarchy_c::memory_hierarchy_c(config_c& config) {
 
   m_config = config;
   m_mem_req_id = 0;    // starting unique request id
   m_cycle = 0;         // memory hierarchy cycle
+  m_num_cycles = 0;
+  m_num_reqs = 0;
 
-  m_l1u_cache = nullptr;
-  m_l1i_cache = nullptr;                     
-  m_l1d_cache = nullptr;                     
-  m_l2_cache = nullptr;                     
-  m_dram = nullptr;                     
+  m_l1i_cache = nullptr;
+  m_l1d_cache = nullptr;
+  m_llc = nullptr;
+  m_dram = nullptr;
+  m_engine = nullptr;
+  m_mmu = nullptr;
 
   m_done_queue = new queue_c();
 
+  m_functional = config.get_param("functional_sim", 0);
+
   init(config);
 
-  // set done requests callback function for children.
-  if (config.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY)) {
-    assert(m_dram && "main memory is not instantiated");
-    m_dram->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1)); 
-  } else if (config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) {
-    assert(m_dram && "main memory is not instantiated");
-    assert(m_l1d_cache && "l1d is not instantiated");
-    m_dram->set_done_func([&](mem_req_s *req) { m_l1d_cache->fill(req); }); 
-    m_l1d_cache->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1)); 
-  } else if (config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) {
-    assert(m_dram && "main memory is not instantiated");
-    assert(m_l1u_cache && "l1u is not instantiated");
-    assert(m_l1i_cache && "L1I cache is not instantiated");
-    assert(m_l1d_cache && "L1D cache is not instantiated");
-    assert(m_l2_cache && "l2 is not instantiated");
-    m_l1u_cache->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1)); 
-    m_l1i_cache->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1)); 
-    m_l1d_cache->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1)); 
-  }
-   
+  // done requests: the top-level caches call push_done_req() directly; the
+  // main memory library only takes a callback
+  assert(m_dram && "main memory is not instantiated");
+  if (m_caches.empty()) {
+    m_dram->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1));
+  } else {
+    assert(m_l1i_cache && m_l1d_cache && "top-level caches are not instantiated");
+  }
+
+  // main memory on its own host thread; nothing to overlap without caches
+  if (config.is_parallel_sim() && m_llc && !m_functional) {
+    m_engine = new parallel_engine_c(m_dram, m_llc, config.get_memory_latency());
+    m_engine->start();
+  }
+
+  m_topology = m_caches.empty() ? TOPO_DRAM_ONLY : (m_engine ? TOPO_CACHES_PARALLEL : TOPO_CACHES);
+
+  // virtual addresses from the core: translate in front of the caches
+  mmu_config_s mc = config.get_mmu_config();
+  if (m_functional && (m_caches.empty() || mc.enable)) {
+    fprintf(stderr, "config: functional_sim needs at least one cache level and no address translation (tlb = 0)\n");
+    assert(false && "Bad functional_sim");
+  }
+  if (mc.enable) {
+    m_mmu = new mmu_c(this, mc);
+    m_mmu->register_stats(m_stats);
+  }
+
+  m_stats.add_counter("memory.cycles", &m_num_cycles);
+  m_stats.add_counter("memory.requests", &m_num_reqs);
+  m_stats.add_histogram("memory.latency", &m_latency_hist);
+
+  if (config.get_param("profile", 0)) m_profiler.enable();
 }
 
 /**
  * This initializes the memory hierarchy to simulate with a given configuration.
+ *
+ * mem_hierarchy gives the number of cache levels N (0: DRAM only).  The top
+ * level is either split into L1I/L1D (l1i_*, l1d_* keys) or unified (l1_*
+ * keys); every level below it is unified and configured by lK_* keys.  Each
+ * level is wired to the one above (prev) and below (next); the last level is
+ * backed by main memory.
  */
 void memory_hierarchy_c::init(config_c& config) {
-  ////////////////////////////////////////////////////////////////////
-  // TODO: Write the code to implement this function
-  // 1. Instantiate caches and main memory (e.g., DRAM)
-  // 2. Configure neighbors of each cache
-  ////////////////////////////////////////////////////////////////////
-  
   // instantiate caches and main memory (e.g., DRAM)
   m_dram = new simple_mem_c("DRAM", MEM_MC, config.get_memory_latency());
 
-  int l1d_num_sets = config.get_l1d_size() / (config.get_l1d_assoc() * config.get_l1d_line_size());
-  m_l1d_cache = new cache_c("L1D", MEM_L1, l1d_num_sets, config.get_l1d_assoc(), config.get_l1d_line_size(), config.get_l1d_latency());
+  // (I-side, D-side) cache of each level; the same cache if unified
+  std::vector<std::pair<cache_c*, cache_c*>> levels;
+
+  for (int level = 1; level <= config.get_num_levels(); ++level) {
+    if (level == 1 && config.is_l1_split()) {
+      cache_c* l1i = create_cache("L1I", "l1i", level);
+      cache_c* l1d = create_cache("L1D", "l1d", level);
+      levels.push_back(std::make_pair(l1i, l1d));
+    } else {
+      std::string id = std::to_string(level);
+      cache_c* cache = create_cache("L" + id, "l" + id, level);
+      levels.push_back(std::make_pair(cache, cache));
+    }
+  }
+
+  // line sizes may differ between levels, but a line of the upper level has
+  // to come from (and go back to) a single line or sector below
+  for (size_t ii = 0; ii + 1 < levels.size(); ++ii) {
+    check_line_sizes(levels[ii].first, levels[ii + 1].second);
+    if (levels[ii].second != levels[ii].first) {
+      check_line_sizes(levels[ii].second, levels[ii + 1].second);
+    }
+    check_write_policy(levels[ii].second, levels[ii + 1].second);
+  }
 
-  int l1i_num_sets = config.get_l1i_size() / (config.get_l1i_assoc() * config.get_l1i_line_size());
-  m_l1i_cache = new cache_c("L1I", MEM_L1, l1i_num_sets, config.get_l1i_assoc(), config.get_l1i_line_size(), config.get_l1i_latency());
+  // configure neighbors of each cache
+  for (size_t ii = 0; ii < levels.size(); ++ii) {
+    cache_c* prev_i = (ii > 0) ? levels[ii - 1].first : nullptr;
+    cache_c* prev_d = (ii > 0) ? levels[ii - 1].second : nullptr;
+    cache_c* next = (ii + 1 < levels.size()) ? levels[ii + 1].second : nullptr;
 
-  // same as l1d
-  m_l1u_cache = new cache_c("L1U", MEM_L1, l1d_num_sets, config.get_l1d_assoc(), config.get_l1d_line_size(), config.get_l1d_latency());
+    levels[ii].first->configure_neighbors(prev_i, prev_d, next, m_dram);
+    if (levels[ii].second != levels[ii].first) {
+      levels[ii].second->configure_neighbors(prev_i, prev_d, next, m_dram);
+    }
+  }
 
-  int l1i_num_set=config.get_l1i_size() / (config.get_l1i_line_size() * config.get_l1i_assoc());
-  m_l1i_cache= new cache_c("L1I", 1, l1i_num_set, config.get_l1i_assoc(), config.get_l1i_line_size(), config.get_l1i_latency());
+  if (!levels.empty()) {
+    m_l1i_cache = levels.front().first;
+    m_l1d_cache = levels.front().second;
+    m_llc = levels.back().second;
+  }
+  m_dram->configure_neighbors(m_llc);
+}
 
-  int l2_num_sets = config.get_l2_size() / (config.get_l2_assoc() * config.get_l2_line_size());
-  m_l2_cache = new cache_c("L2", MEM_L2, l2_num_sets, config.get_l2_assoc(), config.get_l2_line_size(), config.get_l2_latency());
+/**
+ * Line sizes of two adjacent levels.  A miss above is one request below and
+ * a write-back one write-back, so an upper line must fit in one fetch (line
+ * or sector) of the lower level; a larger lower line back-invalidates every
+ * upper line it covers.  An exclusive level swaps whole lines with the level
+ * above, so both need the same unsectored lines.
+ */
+void memory_hierarchy_c::check_line_sizes(cache_c* upper, cache_c* lower) {
+  if (upper->m_line_size > lower->get_fetch_size()) {
+    fprintf(stderr, "config: a %d B line does not fit in a %d B line (or sector) of the level below\n",
+            upper->m_line_size, lower->get_fetch_size());
+    assert(false && "Line size larger than the line size below");
+  }
+  if (lower->get_inclusion() == INCL_EXCLUSIVE &&
+      (upper->m_line_size != lower->m_line_size || upper->is_sectored() || lower->is_sectored())) {
+    fprintf(stderr, "config: an exclusive level needs the same unsectored line size as the level above\n");
+    assert(false && "Exclusive level with a different line size");
+  }
+}
 
-  (*m_l1d_cache).m_mm = this;
-  (*m_l1u_cache).m_mm = this;
-  (*m_l1i_cache).m_mm = this;
-  (*m_l2_cache).m_mm = this;
+/**
+ * Writes passed on by a write-through level (or a write miss that does not
+ * allocate) travel like write-backs, which an exclusive level would install
+ * as victims: only write-back, write-allocate levels may sit above one.
+ * The instruction side never writes.
+ */
+void memory_hierarchy_c::check_write_policy(cache_c* upper, cache_c* lower) {
+  if (lower->get_inclusion() == INCL_EXCLUSIVE && (upper->is_write_through() || !upper->is_write_allocate())) {
+    fprintf(stderr, "config: a level above an exclusive level must be write-back and write-allocate\n");
+    assert(false && "Write-through level above an exclusive level");
+  }
+}
 
-  if (config.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY)) {
-    m_dram->configure_neighbors(nullptr);
-  } else if (config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) {
-    m_dram->configure_neighbors(m_l1d_cache);
-    m_l1d_cache->configure_neighbors(nullptr, nullptr, nullptr, m_dram);
-  } else if (config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) {
-    m_l1i_cache->configure_neighbors(nullptr,nullptr,m_l2_cache,m_dram);
-    m_l1d_cache->configure_neighbors(nullptr,nullptr,m_l2_cache,m_dram);
-    m_l1u_cache->configure_neighbors(nullptr,nullptr,m_l2_cache,m_dram);
+/**
+ * Instantiate one cache from its "<prefix>_*" configuration keys.
+ */
+cache_c* memory_hierarchy_c::create_cache(const std::string& name, const std::string& prefix, int level) {
+  cache_config_s cc = m_config.get_cache_config(prefix);
+  cache_c* cache = new cache_c(name, level, cc.get_num_sets(), cc.assoc, cc.line_size, cc.latency,
+                               cc.inclusion, cc.lazy_sets, cc.sample_sets);
+  cache->m_mm = this;
+  if (cc.sector_size > 0 && cc.sector_size != cc.line_size) {
+    if (cc.sector_size > cc.line_size || cc.line_size % cc.sector_size || cc.line_size / cc.sector_size > 64) {
+      fprintf(stderr, "config: %s_sector_size must divide %s_line_size into at most 64 sectors\n",
+              prefix.c_str(), prefix.c_str());
+      assert(false && "Bad sector_size");
+    }
+    if (cc.victim_entries > 0) {
+      fprintf(stderr, "config: %s: a sectored cache cannot have a victim cache\n", prefix.c_str());
+      assert(false && "Sectored cache with a victim cache");
+    }
+    cache->enable_sectors(cc.sector_size);
+  }
+  if (cc.victim_entries > 0) {
+    cache->attach_victim_cache(cc.victim_entries, cc.victim_latency);
+  }
+  if (cc.write_buffer_entries > 0) {
+    // a buffered write-back drains when the next level is idle, which depends on timing
+    if (m_functional) {
+      fprintf(stderr, "config: %s: functional_sim does not model write buffers\n", prefix.c_str());
+      assert(false && "Write buffer in functional mode");
+    }
+    cache->attach_write_buffer(cc.write_buffer_entries);
+  }
+  if (cc.write_policy != WRITE_POLICY_BACK || !cc.write_allocate) {
+    set_write_policy(cache, cc, prefix, level);
+  }
+  if (cc.attribution > 0) {
+    cache->enable_attribution(cc.attribution, m_config.get_param("attribution_page_size", 4096));
+    std::string ranges = m_config.get_string("attribution_ranges", "");
+    if (!cache->get_attribution()->add_ranges(ranges)) {
+      fprintf(stderr, "config: bad attribution_ranges '%s'\n", ranges.c_str());
+      assert(false && "Bad attribution_ranges");
+    }
+  }
+  if (cc.classify_misses) {
+    cache->enable_miss_classification();
+  }
+  if (cc.way_partition != PARTITION_NONE) {
+    enable_way_partition(cache, cc, prefix);
+  }
+  if (m_functional) {
+    cache->set_functional();
+  }
+  cache->register_stats(m_stats, prefix);
+  m_caches.push_back(cache);
+  return cache;
+}
 
-    // unified
-    // m_l2_cache->configure_neighbors(nullptr, m_l1u_cache, nullptr, m_dram);
+/**
+ * Write-through and no-write-allocate.  A store of the top level that sends
+ * its data down retires into the write buffer, so one is required there.
+ * Below the top level, writes from above that miss are always passed on
+ * (never allocated), and an exclusive level never holds dirty data apart
+ * from its victims, so it stays write-back.
+ */
+void memory_hierarchy_c::set_write_policy(cache_c* cache, const cache_config_s& cc, const std::string& prefix,
+                                          int level) {
+  if (cc.write_policy < 0 || cc.write_policy >= WRITE_POLICY_LAST ||
+      (cc.write_policy == WRITE_POLICY_THROUGH && cc.inclusion == INCL_EXCLUSIVE)) {
+    fprintf(stderr, "config: %s_write_policy must be 0 or 1, and 0 on an exclusive level\n", prefix.c_str());
+    assert(false && "Bad write_policy");
+  }
+  if (!cc.write_allocate && level != MEM_L1) {
+    fprintf(stderr, "config: %s_write_allocate = 0 only applies to the top level\n", prefix.c_str());
+    assert(false && "Bad write_allocate");
+  }
+  if (level == MEM_L1 && cc.write_buffer_entries <= 0) {
+    fprintf(stderr, "config: %s: write-through or no-write-allocate needs %s_write_buffer_entries > 0\n",
+            prefix.c_str(), prefix.c_str());
+    assert(false && "Write-through without a write buffer");
+  }
+  cache->set_write_policy(cc.write_policy, cc.write_allocate);
+}
 
-    // splited
-    m_l2_cache->configure_neighbors(m_l1i_cache, m_l1d_cache, nullptr, m_dram);
+/**
+ * Split the ways of a cache between instruction and data lines.  Fixed masks
+ * must each name at least one existing way (they may overlap); the
+ * utility-based mode starts from an even split.  An exclusive level is
+ * filled by victims, which do not say which stream they came from.
+ */
+void memory_hierarchy_c::enable_way_partition(cache_c* cache, const cache_config_s& cc, const std::string& prefix) {
+  if (cc.way_partition < 0 || cc.way_partition >= PARTITION_LAST || cc.assoc > 32 ||
+      cc.inclusion == INCL_EXCLUSIVE) {
+    fprintf(stderr, "config: %s_way_partition must be 0, 1 or 2, on a non-exclusive cache of at most 32 ways\n",
+            prefix.c_str());
+    assert(false && "Bad way_partition");
+  }
 
-    m_dram->configure_neighbors(m_l2_cache);
+  uint32_t all_ways = (cc.assoc == 32) ? ~0u : (1u << cc.assoc) - 1;
+  if (cc.way_partition == PARTITION_FIXED) {
+    if (!cc.inst_way_mask || !cc.data_way_mask || (cc.inst_way_mask | cc.data_way_mask) & ~all_ways) {
+      fprintf(stderr, "config: %s_inst_way_mask and %s_data_way_mask must each select some of the %d ways\n",
+              prefix.c_str(), prefix.c_str(), cc.assoc);
+      assert(false && "Bad way masks");
+    }
+    cache->enable_way_partition(cc.inst_way_mask, cc.data_way_mask, 0);
+  } else {
+    if (cc.assoc < 2 || cc.partition_interval <= 0 || cc.sample_sets > 1) {
+      fprintf(stderr, "config: %s: utility-based partitioning needs 2+ ways, %s_partition_interval > 0 "
+              "and no set sampling\n", prefix.c_str(), prefix.c_str());
+      assert(false && "Bad utility-based partitioning");
+    }
+    uint32_t inst_mask = (1u << (cc.assoc / 2)) - 1;
+    cache->enable_way_partition(inst_mask, all_ways & ~inst_mask, cc.partition_interval);
   }
 }
 
 /**
  * This creates a new memory request for the given memory address and accesses the top-level
- * memory components in the memory hierarchy (e.g., L1 or main memory). 
+ * memory components in the memory hierarchy (e.g., L1 or main memory).
  */
 
 bool memory_hierarchy_c::access(addr_t address, int access_type) {
@@ -119,39 +295,67 @@ bool memory_hierarchy_c::access(addr_t address, int access_type) {
 
   m_in_flight_reqs.push_back(req);
 
-  ////////////////////////////////////////////////////////////////////
-  // TODO: Write the code to implement this function
-  // Access the top-level memory component
-  ////////////////////////////////////////////////////////////////////
+  // the request waits here for its translation (TLB miss) if need be
+  if (m_mmu) {
+    m_mmu->translate(req);
+    return true;
+  }
+  return issue(req);
+}
+
+/**
+ * Functional mode: the access goes through the caches at once (see
+ * cache_c::access_func); no request is created and no cycle passes.
+ */
+void memory_hierarchy_c::access_functional(addr_t address, int access_type) {
+  drain_functional();
+  ++m_num_reqs;
+  if (access_type == INST_FETCH) {
+    m_l1i_cache->access_func(address, access_type);
+  } else {
+    m_l1d_cache->access_func(address, access_type);
+  }
+}
 
-  if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY)) {
+/**
+ * Functional mode: the write-backs (and clean victims) sent down by the last
+ * access reach their level, oldest first, as they do in the timing model
+ * before the next access gets there.  Lines they displace in turn are
+ * appended and absorbed in the same pass.
+ */
+void memory_hierarchy_c::drain_functional() {
+  for (size_t ii = 0; ii < m_functional_wbs.size(); ++ii) {
+    functional_wb_s wb = m_functional_wbs[ii];
+    wb.m_dest->write_back_func(wb.m_addr, wb.m_dirty);
+  }
+  m_functional_wbs.clear();
+}
+
+/**
+ * Access the top-level memory component with a request whose address is
+ * physical.
+ */
+bool memory_hierarchy_c::issue(mem_req_s* req) {
+  int access_type = req->m_type;
+  if (m_topology == TOPO_DRAM_ONLY) {
     return m_dram->access(req);
-  } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) { 
+  } else if (access_type == INST_FETCH) {
+    return m_l1i_cache->access(req);
+  } else {
     return m_l1d_cache->access(req);
-  } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) { 
-    // unified
-    // return m_l1u_cache->access(req);
-    
-    // splited
-    if(access_type == INST_FETCH){
-       return m_l1i_cache->access(req);
-    }
-    else{
-       return m_l1d_cache->access(req);
-    }
   }
-  return false;
 }
 
 /**
- * Create a new memory request that goes through memory hierarchy.  
+ * Create a new memory request that goes through memory hierarchy.
  * @note You do not have to modify this (other than for debugging purposes).
  */
-mem_req_s* memory_hierarchy_c::create_mem_req(addr_t address, int access_type) { 
-  
+mem_req_s* memory_hierarchy_c::create_mem_req(addr_t address, int access_type) {
+
   mem_req_s* req = new mem_req_s(address, access_type);
 
   req->m_id = m_mem_req_id++;
+  ++m_num_reqs;
   req->m_in_cycle = m_cycle;
   req->m_rdy_cycle = m_cycle;
   req->m_done = false;
@@ -165,37 +369,58 @@ mem_req_s* memory_hierarchy_c::create_mem_req(addr_t address, int access_type) {
  * Tick a cycle for memory hierarchy.
  */
 void memory_hierarchy_c::run_a_cycle() {
-  ////////////////////////////////////////////////////////////////////
-  // \TODO: Write the code to implement this function
-  // 1. Tick a acycle for each cache/memory component
-  // Think carefully what should be the order of run_a_cycle
-  // 2. Process done requests.
-  ////////////////////////////////////////////////////////////////////
+  switch (m_topology) {
+    case TOPO_DRAM_ONLY:       tick<TOPO_DRAM_ONLY>();       break;
+    case TOPO_CACHES:          tick<TOPO_CACHES>();          break;
+    case TOPO_CACHES_PARALLEL: tick<TOPO_CACHES_PARALLEL>(); break;
+    default: assert(false);
+  }
+}
 
-  if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY)) {
-    m_dram->run_a_cycle();
-  } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) { 
-    m_l1d_cache->run_a_cycle();
-    m_dram->run_a_cycle();
-  } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) { 
-    //splited
-    m_l1i_cache->run_a_cycle();
-    m_l1d_cache->run_a_cycle();
-
-    //unified
-    //m_l1u_cache->run_a_cycle();
-    m_l2_cache->run_a_cycle();
+/**
+ * One cycle of a given topology; the topology is a template parameter, so
+ * each instance only contains the calls its components need.
+ * 1. Tick a cycle for each cache/memory component, top level first
+ *    (L1I, L1D, L2, ..., DRAM)
+ * 2. Process done requests.
+ */
+template <int TOPOLOGY>
+void memory_hierarchy_c::tick() {
+  // with the parallel engine, m_dram ticks on the memory thread
+  if (TOPOLOGY == TOPO_CACHES_PARALLEL) {
+    profile_scope_c profile(m_profiler, PROF_DRAM);
+    m_engine->begin_cycle(m_cycle);
+  }
+
+  if (m_mmu) {
+    profile_scope_c profile(m_profiler, PROF_MMU);
+    m_mmu->run_a_cycle();
+  }
+
+  if (TOPOLOGY != TOPO_DRAM_ONLY) {
+    for (cache_c* cache : m_caches) {
+      cache->run_a_cycle();
+    }
+  }
+  if (TOPOLOGY != TOPO_CACHES_PARALLEL) {
+    profile_scope_c profile(m_profiler, PROF_DRAM);
     m_dram->run_a_cycle();
-  } 
+  }
+
+  {
+    profile_scope_c profile(m_profiler, PROF_DONE);
+    process_done_req();
+  }
 
-  process_done_req();
+  if (TOPOLOGY == TOPO_CACHES_PARALLEL) m_engine->end_cycle(m_cycle);
 
-  ++m_cycle; 
+  ++m_cycle;
+  ++m_num_cycles;
 }
 
 /**
  * This function processes the done request. The done_queue contains the
- * requests whose data is ready to return to the core.  
+ * requests whose data is ready to return to the core.
  * Processing a "done request" means sending the data to the core (conceptually).
  */
 void memory_hierarchy_c::process_done_req() {
@@ -203,8 +428,12 @@ void memory_hierarchy_c::process_done_req() {
   // TODO: Write the code to implement this function
   // Free done requests
   ////////////////////////////////////////////////////////////////////
-  
+
   for (auto it = m_done_queue->m_entry.begin(); it != m_done_queue->m_entry.end(); ) {
+    // a page-table entry read moves its walk on; it is not a core request
+    if (!m_mmu || !m_mmu->complete(*it)) {
+      m_latency_hist.sample(m_cycle - (*it)->m_in_cycle);
+    }
     free_mem_req(*it);
     ++it;
   }
@@ -225,41 +454,16 @@ void memory_hierarchy_c::free_mem_req(mem_req_s* req) {
 #endif
 }
 
-/**
- * This function is called when the request is done and data is ready to return to the core.
- * This is called Tfrom the top-level memory component.
- */
-void memory_hierarchy_c::push_done_req(mem_req_s* req) {
-  DEBUG("[MEM_H] Done REQ #%d %8lx @ %ld\n", req->m_id, req->m_addr, m_cycle);
-  m_done_queue->push(req);
-}
-
 /**
  * This function checks if all the in-flight writebacks are done. This is the point
  * where we finish up the simulation.
  */
 bool memory_hierarchy_c::is_wb_done() {
-  ////////////////////////////////////////////////////////////////////
-  // TODO: Write the code to implement this function
   // If there is no in-flight writeback requests for all the caches and
   // main memory, return true.
-  ////////////////////////////////////////////////////////////////////
-  bool is_done = false;
-  if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY)) {
-    is_done = m_dram->m_in_flight_wb_queue->empty();
-  } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) { 
-    is_done = m_dram->m_in_flight_wb_queue->empty() && 
-              m_l1d_cache->m_in_flight_wb_queue->empty();
-  } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) { 
-    // unified
-    // is_done = m_dram->m_in_flight_wb_queue->empty() && 
-    //           m_l1u_cache->m_in_flight_wb_queue->empty() && 
-    //           m_l2_cache->m_in_flight_wb_queue->empty();
-    // unified
-    is_done = m_dram->m_in_flight_wb_queue->empty() && 
-              m_l1i_cache->m_in_flight_wb_queue->empty() && 
-              m_l1d_cache->m_in_flight_wb_queue->empty() && 
-              m_l2_cache->m_in_flight_wb_queue->empty();
+  bool is_done = m_engine ? m_engine->is_wb_done() : m_dram->m_in_flight_wb_queue->empty();
+  for (cache_c* cache : m_caches) {
+    is_done = is_done && cache->m_in_flight_wb_queue->empty();
   }
 
   return is_done;
@@ -267,31 +471,78 @@ bool memory_hierarchy_c::is_wb_done() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 memory_hierarchy_c::~memory_hierarchy_c() {
-  if (m_l1u_cache) delete m_l1u_cache;
-  if (m_l1i_cache) delete m_l1i_cache;
-  if (m_l1d_cache) delete m_l1d_cache;
-  if (m_l2_cache)  delete m_l2_cache;
-  if (m_dram)      delete m_dram;
+  if (m_engine) delete m_engine;  // joins the memory thread
+  if (m_mmu)    delete m_mmu;
+  for (cache_c* cache : m_caches) delete cache;
+  if (m_dram)   delete m_dram;
+  delete m_done_queue;
 }
 
 void memory_hierarchy_c::print_stats() {
+  for (cache_c* cache : m_caches) {
+    cache->print_stats();
+  }
+  if (m_mmu) {
+    m_mmu->print_stats();
+  }
 
-  if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) {
-    m_l1d_cache->print_stats();
-  } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) {
-    // unified
-    // m_l1u_cache->print_stats();
+  // effective capacity: distinct lines held by the whole hierarchy at the end
+  // of the run (an exclusive level adds its full capacity; an inclusive one
+  // duplicates the lines above it).  With different line sizes, lines are
+  // counted in units of the smallest one.
+  if (m_caches.size() >= 2) {
+    int unit_size = m_caches.front()->m_line_size;
+    for (cache_c* cache : m_caches) {
+      unit_size = std::min(unit_size, cache->m_line_size);
+    }
 
-    // splited
-    m_l1i_cache->print_stats();
-    m_l1d_cache->print_stats();
-    m_l2_cache->print_stats();
+    std::vector<addr_t> lines;
+    size_t capacity = 0;
+    for (cache_c* cache : m_caches) {
+      capacity += (size_t)cache->get_num_lines() * (cache->m_line_size / unit_size);
+      cache->count_lines(lines, unit_size);
+    }
+    size_t num_cached = lines.size();
+    std::sort(lines.begin(), lines.end());
+    size_t num_unique = std::unique(lines.begin(), lines.end()) - lines.begin();
+
+    std::cout << "------------------------------" << "\n";
+    std::cout << "Hierarchy Effective Capacity: " << (capacity ? (double)num_unique / capacity * 100 : 0.0) << " % \n";
+    std::cout << "------------------------------" << "\n";
+    std::cout << "total capacity (lines): " << capacity << "\n";
+    std::cout << "valid lines: " << num_cached << "\n";
+    std::cout << "unique valid lines: " << num_unique << "\n";
+  }
+}
+
+/**
+ * Zero the statistics of every level, the MMU and the request latencies in
+ * the same cycle, so that all of them cover the same window.  Cache
+ * contents, requests in flight and the clocks are not touched.
+ */
+void memory_hierarchy_c::reset_stats() {
+  for (cache_c* cache : m_caches) {
+    cache->reset_stats();
+  }
+  if (m_mmu) {
+    m_mmu->reset_stats();
+  }
+  m_latency_hist = histogram_c();
+  m_num_cycles = 0;
+  m_num_reqs = 0;
+}
+
+/**
+ * Per-set miss/eviction CSV of every cache with miss attribution.
+ */
+void memory_hierarchy_c::dump_attribution() {
+  for (cache_c* cache : m_caches) {
+    cache->dump_attribution();
   }
 }
 
 void memory_hierarchy_c::dump(bool is_file) {
-  if (m_l1u_cache) m_l1u_cache->dump_tag_store(is_file);
-  if (m_l1i_cache) m_l1i_cache->dump_tag_store(is_file);
-  if (m_l1d_cache) m_l1d_cache->dump_tag_store(is_file);
-  if (m_l2_cache)  m_l2_cache->dump_tag_store(is_file);
+  for (cache_c* cache : m_caches) {
+    cache->dump_tag_store(is_file);
+  }
 }
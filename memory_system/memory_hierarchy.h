@@ -8,18 +8,31 @@
 #include "memory_controller/simple_mem.h"
 #include "cache.h"
 #include "config.h"
+#include "profiler.h"
 
 #include <vector>
-
-enum class Hierarchy {
-  DRAM_ONLY,
-  SINGLE_LEVEL,
-  MULTI_LEVEL
-};
+#include <string>
 
 // forward declaration
 class cache_c;
 class simple_mem_c;
+class parallel_engine_c;
+class mmu_c;
+
+/// (functional_sim) a line on its way to the next level
+struct functional_wb_s {
+  cache_c* m_dest;                             ///< level that takes it
+  addr_t m_addr;
+  bool m_dirty;                                ///< false: a clean victim for an exclusive level
+};
+
+/// shape of the hierarchy, resolved once at construction
+enum HIERARCHY_TOPOLOGY {
+  TOPO_DRAM_ONLY = 0,      ///< the core talks to main memory directly
+  TOPO_CACHES,             ///< caches and main memory tick on this thread
+  TOPO_CACHES_PARALLEL,    ///< main memory ticks on the parallel engine's thread
+  TOPO_LAST
+};
 
 class memory_hierarchy_c {
 public:
@@ -28,11 +41,19 @@ public:
 
   void init(config_c& config);                 ///< initialize memory hierarchy
   bool access(addr_t addr, int access_type);   ///< access function
+  void access_functional(addr_t addr, int access_type);  ///< (functional_sim) access served at once
+  bool is_functional() const { return m_functional; }    ///< cache contents only: no queues or cycles
+  void drain_functional();                     ///< (functional_sim) absorb the write-backs of the last access
+  void push_functional_wb(cache_c* dest, addr_t addr, bool dirty) {
+    m_functional_wbs.push_back({dest, addr, dirty});
+  }
   void run_a_cycle();                          ///< tick a cycle
 
   config_c m_config;
   
   friend class cache_c;
+  friend class mmu_c;
+  friend class microbench_c;                   ///< bench/microbench.cc
 
   /// @brief if the request is repeated and miss, return true
   /// @param req 
@@ -64,28 +85,54 @@ public:
   }
                                                
 private:
+  cache_c* create_cache(const std::string& name, const std::string& prefix, int level);
+  void check_line_sizes(cache_c* upper, cache_c* lower);  ///< adjacent levels fit together
+  void check_write_policy(cache_c* upper, cache_c* lower);  ///< writes from above can reach the level below
+  void set_write_policy(cache_c* cache, const cache_config_s& cc, const std::string& prefix, int level);
+  void enable_way_partition(cache_c* cache, const cache_config_s& cc, const std::string& prefix);
+  template <int TOPOLOGY> void tick();         ///< run_a_cycle for one topology
+
+  bool issue(mem_req_s* req);                  ///< send a (physical) request to the top level
   mem_req_s* create_mem_req(addr_t address, int access_type);
   void free_mem_req(mem_req_s* req);
 
   counter m_mem_req_id;                        ///< memory request id to assign
   simple_mem_c* m_dram;                        ///< simple main memory
   counter m_cycle;                             ///< clock cycle
+  counter m_num_cycles;                        ///< cycles since the last reset_stats
+  counter m_num_reqs;                          ///< requests created since the last reset_stats
+  parallel_engine_c* m_engine;                 ///< runs m_dram on its own thread (if enabled)
+  mmu_c* m_mmu;                                ///< address translation (nullptr: addresses are physical)
+  int m_topology;                              ///< HIERARCHY_TOPOLOGY
+  bool m_functional;                           ///< functional_sim: caches only, no timing
+  std::vector<functional_wb_s> m_functional_wbs;  ///< (functional_sim) write-backs of the last access, in order
                                                
 public:
   void dump(bool is_file);                     ///< dump the data in cache after simulation
+  void dump_attribution();                     ///< per-set miss CSV of caches with attribution
 
   void process_done_req();
-  void push_done_req(mem_req_s* req);
+
+  /// the request is done and its data is ready to return to the core
+  void push_done_req(mem_req_s* req) {
+    DEBUG("[MEM_H] Done REQ #%d %8lx @ %ld\n", req->m_id, req->m_addr, m_cycle);
+    m_done_queue->push(req);
+  }
   bool is_wb_done();
   void print_stats();
+  void reset_stats();                          ///< zero the stats of every level at once (end of the warmup)
+  bool dump_stats(const std::string& filename) const { return m_stats.dump(filename); }
+
+  stats_registry_c m_stats;                    ///< named stats of every component (dump_stats)
+  histogram_c m_latency_hist;                  ///< cycles from request creation to done
+  profiler_c m_profiler;                       ///< host time per simulation stage (profile)
   int  get_num_in_flight_reqs(void) { return m_in_flight_reqs.size(); }
                                               
 private:
-  cache_c* m_l1u_cache;                        ///< l1u_cache for unified I/D
-  cache_c* m_l1i_cache;                        ///< l1i_cache
-  cache_c* m_l1d_cache;                        ///< l1d_cache 
-
-  cache_c* m_l2_cache;                         ///< l2_cache
+  std::vector<cache_c*> m_caches;              ///< all caches, top level first (tick order)
+  cache_c* m_l1i_cache;                        ///< top-level cache for instructions
+  cache_c* m_l1d_cache;                        ///< top-level cache for data (== m_l1i_cache if unified)
+  cache_c* m_llc;                              ///< last-level cache (filled by m_dram)
                                                
   std::vector<mem_req_s*> m_in_flight_reqs;    ///< memory requests in the memory hierarchy
   queue_c* m_done_queue;                       ///< holds the requests that are done (i.e., data ready for the core)
@@ -0,0 +1,198 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class mmu_c
+ *
+ * TLBs, page walks and page allocation; see mmu.h.
+ */
+
+#include "mmu.h"
+#include "memory_hierarchy.h"
+
+#include <cassert>
+#include <iostream>
+
+mmu_c::mmu_c(memory_hierarchy_c* mm, const mmu_config_s& mc) {
+  m_mm = mm;
+  m_itlb = new tlb_c("ITLB", mc.itlb.entries, mc.itlb.assoc, mc.itlb.latency);
+  m_dtlb = new tlb_c("DTLB", mc.dtlb.entries, mc.dtlb.assoc, mc.dtlb.latency);
+  m_stlb = new tlb_c("STLB", mc.stlb.entries, mc.stlb.assoc, mc.stlb.latency);
+  m_page_table = new page_table_c(mc.page_alloc, mc.phys_mem_mb, mc.seed);
+  m_num_walkers = mc.page_walkers;
+  assert(m_num_walkers > 0);
+
+  m_num_walks = 0;
+  m_num_pte_reads = 0;
+  m_walk_cycles = 0;
+  m_num_walk_merges = 0;
+}
+
+mmu_c::~mmu_c() {
+  delete m_itlb;
+  delete m_dtlb;
+  delete m_stlb;
+  delete m_page_table;
+}
+
+/**
+ * L1 TLB, then L2 TLB (which refills the L1 TLB).
+ * @param latency - set to the extra cycles of the translation on a hit
+ */
+bool mmu_c::lookup(mem_req_s* req, int& latency) {
+  tlb_c* l1 = (req->m_type == REQ_IFETCH) ? m_itlb : m_dtlb;
+  translation_s translation;
+
+  if (l1->lookup(req->m_addr, translation)) {
+    latency = l1->get_latency();
+  } else if (m_stlb->lookup(req->m_addr, translation)) {
+    l1->insert(translation);
+    latency = m_stlb->get_latency();
+  } else {
+    return false;
+  }
+
+  req->m_addr = translation.translate(req->m_addr);
+  return true;
+}
+
+void mmu_c::translate(mem_req_s* req) {
+  int latency;
+  if (!lookup(req, latency)) {
+    start_walk(req);
+  } else if (latency == 0) {
+    m_mm->issue(req);
+  } else {
+    m_delayed.push_back(std::make_pair(m_mm->m_cycle + latency, req));
+  }
+}
+
+/**
+ * Walk the page table for a request that missed both TLBs, or wait for the
+ * walk of its page that is already in progress.
+ */
+void mmu_c::start_walk(mem_req_s* req) {
+  addr_t vbase = m_page_table->translate(req->m_addr).m_vbase;
+  for (walk_s& walk : m_walks) {
+    if (m_page_table->translate(walk.m_vaddr).m_vbase == vbase) {
+      ++m_num_walk_merges;
+      walk.m_waiting.push_back(req);
+      return;
+    }
+  }
+
+  if ((int)m_walks.size() >= m_num_walkers) {
+    m_walk_queue.push_back(req);
+    return;
+  }
+
+  ++m_num_walks;
+  m_walks.push_back(walk_s());
+  walk_s& walk = m_walks.back();
+  walk.m_vaddr = req->m_addr;
+  walk.m_inst = (req->m_type == REQ_IFETCH);
+  walk.m_num_levels = m_page_table->walk(req->m_addr, walk.m_pte_addr);
+  walk.m_level = 0;
+  walk.m_start_cycle = m_mm->m_cycle;
+  walk.m_waiting.push_back(req);
+  issue_pte_read(walk);
+}
+
+/**
+ * Read the page-table entry of the current level: a data read that goes
+ * through the data cache hierarchy like any other.
+ */
+void mmu_c::issue_pte_read(walk_s& walk) {
+  ++m_num_pte_reads;
+  mem_req_s* req = m_mm->create_mem_req(walk.m_pte_addr[walk.m_level], REQ_DFETCH);
+  m_mm->m_in_flight_reqs.push_back(req);
+  walk.m_pte_req = req;
+  m_mm->issue(req);
+}
+
+bool mmu_c::complete(mem_req_s* req) {
+  for (auto it = m_walks.begin(); it != m_walks.end(); ++it) {
+    if (it->m_pte_req != req) continue;
+
+    if (++it->m_level < it->m_num_levels) {
+      issue_pte_read(*it);
+    } else {
+      finish_walk(it);
+    }
+    return true;
+  }
+  return false;
+}
+
+/**
+ * The last entry arrived: fill the TLBs, release the waiting requests and
+ * hand the walker to the next queued miss.
+ */
+void mmu_c::finish_walk(std::list<walk_s>::iterator it) {
+  translation_s translation = m_page_table->translate(it->m_vaddr);
+  m_stlb->insert(translation);
+  (it->m_inst ? m_itlb : m_dtlb)->insert(translation);
+  m_walk_cycles += m_mm->m_cycle - it->m_start_cycle;
+
+  for (mem_req_s* req : it->m_waiting) {
+    req->m_addr = m_page_table->translate(req->m_addr).translate(req->m_addr);
+    m_mm->issue(req);
+  }
+  m_walks.erase(it);
+
+  while ((int)m_walks.size() < m_num_walkers && !m_walk_queue.empty()) {
+    mem_req_s* req = m_walk_queue.front();
+    m_walk_queue.pop_front();
+    translate(req);
+  }
+}
+
+void mmu_c::run_a_cycle() {
+  while (!m_delayed.empty() && m_delayed.front().first <= m_mm->m_cycle) {
+    m_mm->issue(m_delayed.front().second);
+    m_delayed.pop_front();
+  }
+}
+
+void mmu_c::print_stats() {
+  m_itlb->print_stats();
+  m_dtlb->print_stats();
+  m_stlb->print_stats();
+
+  std::cout << "------------------------------" << "\n";
+  std::cout << "Page Walks" << "\n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "number of walks: " << m_num_walks << "\n";
+  std::cout << "number of page-table entry reads: " << m_num_pte_reads << "\n";
+  std::cout << "number of misses merged into a walk: " << m_num_walk_merges << "\n";
+  std::cout << "average walk latency: " << (m_num_walks ? (double)m_walk_cycles / m_num_walks : 0.0) << "\n";
+  std::cout << "number of pages allocated: " << m_page_table->m_num_pages << "\n";
+  std::cout << "number of page-table nodes: " << m_page_table->m_num_nodes << "\n";
+}
+
+/**
+ * Zero the TLB and walk counts; translations, walks in progress and the
+ * page table stay.
+ */
+void mmu_c::reset_stats() {
+  m_itlb->reset_stats();
+  m_dtlb->reset_stats();
+  m_stlb->reset_stats();
+  m_num_walks = 0;
+  m_num_pte_reads = 0;
+  m_walk_cycles = 0;
+  m_num_walk_merges = 0;
+}
+
+void mmu_c::register_stats(stats_registry_c& stats) {
+  m_itlb->register_stats(stats, "itlb");
+  m_dtlb->register_stats(stats, "dtlb");
+  m_stlb->register_stats(stats, "stlb");
+  stats.add_counter("mmu.walks", &m_num_walks);
+  stats.add_counter("mmu.pte_reads", &m_num_pte_reads);
+  stats.add_counter("mmu.walk_merges", &m_num_walk_merges);
+  stats.add_ratio("mmu.avg_walk_latency", &m_walk_cycles, &m_num_walks);
+  stats.add_counter("mmu.pages", &m_page_table->m_num_pages);
+  stats.add_counter("mmu.page_table_nodes", &m_page_table->m_num_nodes);
+}
@@ -0,0 +1,81 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __MMU_H__
+#define __MMU_H__
+
+#include "atom/global.h"
+#include "atom/mem_req.h"
+#include "config.h"
+#include "page_table.h"
+#include "tlb.h"
+
+#include <deque>
+#include <list>
+#include <vector>
+
+// forward declaration
+class memory_hierarchy_c;
+
+/**
+ *
+ * @class mmu_c
+ *
+ * Address translation in front of the caches.  Requests from the core carry
+ * virtual addresses; they leave with physical ones.
+ * - L1 TLB (I or D) hit: no extra latency (overlapped with the L1 access)
+ * - L2 TLB hit: ready after the L2 TLB latency
+ * - miss: a page walk reads one page-table entry per level through the data
+ *   cache hierarchy, one after the other; requests to the same page wait on
+ *   the same walk.  At most m_num_walkers walks run at once; later misses
+ *   queue up.
+ */
+class mmu_c {
+public:
+  mmu_c(memory_hierarchy_c* mm, const mmu_config_s& mc);
+  ~mmu_c();
+
+  void translate(mem_req_s* req);   ///< translate and issue a core request
+  void run_a_cycle();               ///< issue requests whose L2 TLB lookup finished
+  bool complete(mem_req_s* req);    ///< a done request; true if it was a walk's entry read
+
+  void print_stats();
+  void reset_stats();
+  void register_stats(stats_registry_c& stats);
+
+private:
+  struct walk_s {
+    addr_t m_vaddr;
+    bool m_inst;                          ///< fill the I-side L1 TLB
+    addr_t m_pte_addr[page_table_c::NUM_LEVELS];
+    int m_num_levels;
+    int m_level;                          ///< entry being read
+    mem_req_s* m_pte_req;                 ///< in-flight entry read
+    counter m_start_cycle;
+    std::vector<mem_req_s*> m_waiting;    ///< requests to the page being walked
+  };
+
+  bool lookup(mem_req_s* req, int& latency);  ///< TLB lookup; on a hit, req has its physical address
+  void start_walk(mem_req_s* req);
+  void issue_pte_read(walk_s& walk);
+  void finish_walk(std::list<walk_s>::iterator it);
+
+  memory_hierarchy_c* m_mm;
+  tlb_c* m_itlb;                            ///< L1 instruction TLB
+  tlb_c* m_dtlb;                            ///< L1 data TLB
+  tlb_c* m_stlb;                            ///< unified L2 TLB
+  page_table_c* m_page_table;
+  int m_num_walkers;                        ///< concurrent page walks
+
+  std::list<walk_s> m_walks;                ///< walks in progress
+  std::deque<mem_req_s*> m_walk_queue;      ///< misses waiting for a walker
+  std::deque<std::pair<counter, mem_req_s*>> m_delayed;  ///< (ready cycle, request) after an L2 TLB hit
+
+  // statistics
+  counter m_num_walks;
+  counter m_num_pte_reads;
+  counter m_walk_cycles;                    ///< sum of walk latencies
+  counter m_num_walk_merges;                ///< misses that joined a walk in progress
+};
+
+#endif // !__MMU_H__
@@ -0,0 +1,106 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class page_table_c
+ *
+ * Page allocation and page-table layout; see page_table.h.
+ */
+
+#include "page_table.h"
+
+#include <cassert>
+#include <random>
+
+namespace {
+const int LEVEL_BITS = 9;                          ///< 512 entries per node
+const int PTE_SIZE = 8;
+const uint64_t FRAMES_PER_HUGE = 1 << (PAGE_BITS_2M - PAGE_BITS_4K);
+}
+
+/**
+ * @param policy - PAGE_ALLOC_POLICY
+ * @param phys_mem_mb - physical memory size in MB (power of two)
+ * @param seed - seed of the random policy
+ */
+page_table_c::page_table_c(int policy, int phys_mem_mb, uint64_t seed) {
+  assert(policy >= 0 && policy < PAGE_ALLOC_LAST && "Unknown page_alloc");
+  assert(phys_mem_mb > 0 && (phys_mem_mb & (phys_mem_mb - 1)) == 0 && "phys_mem_mb must be a power of two");
+
+  m_policy = policy;
+  m_num_frames = (uint64_t)phys_mem_mb << (20 - PAGE_BITS_4K);
+  m_next_frame = 0;
+
+  // an odd multiplier makes n -> n * mul + add a permutation of the frames
+  std::mt19937_64 rng(seed);
+  m_random_mul = rng() | 1;
+  m_random_add = rng();
+
+  m_num_pages = 0;
+  m_num_nodes = 0;
+}
+
+addr_t page_table_c::alloc_frame() {
+  assert(m_next_frame < m_num_frames && "out of physical memory (phys_mem_mb)");
+  uint64_t frame = m_next_frame++;
+  if (m_policy == PAGE_ALLOC_RANDOM) {
+    frame = (frame * m_random_mul + m_random_add) & (m_num_frames - 1);
+  }
+  return (addr_t)frame << PAGE_BITS_4K;
+}
+
+addr_t page_table_c::alloc_huge_frame() {
+  m_next_frame = (m_next_frame + FRAMES_PER_HUGE - 1) / FRAMES_PER_HUGE * FRAMES_PER_HUGE;
+  assert(m_next_frame + FRAMES_PER_HUGE <= m_num_frames && "out of physical memory (phys_mem_mb)");
+  addr_t base = (addr_t)m_next_frame << PAGE_BITS_4K;
+  m_next_frame += FRAMES_PER_HUGE;
+  return base;
+}
+
+/**
+ * Node of the given level (4: root, 1: last level of a 4K page) on the path
+ * of vaddr; allocated on first use.
+ */
+addr_t page_table_c::node(int level, addr_t vaddr) {
+  addr_t prefix = vaddr >> (PAGE_BITS_4K + LEVEL_BITS * level);
+  addr_t key = (prefix << 3) | level;
+
+  auto it = m_nodes.find(key);
+  if (it != m_nodes.end()) return it->second;
+
+  ++m_num_nodes;
+  addr_t frame = alloc_frame();
+  m_nodes[key] = frame;
+  return frame;
+}
+
+translation_s page_table_c::translate(addr_t vaddr) {
+  int page_bits = (m_policy == PAGE_ALLOC_HUGE) ? PAGE_BITS_2M : PAGE_BITS_4K;
+  addr_t vbase = vaddr >> page_bits << page_bits;
+
+  auto it = m_pages.find(vbase);
+  if (it != m_pages.end()) return it->second;
+
+  ++m_num_pages;
+  translation_s translation;
+  translation.m_vbase = vbase;
+  translation.m_pbase = (page_bits == PAGE_BITS_2M) ? alloc_huge_frame() : alloc_frame();
+  translation.m_page_bits = page_bits;
+  m_pages[vbase] = translation;
+  return translation;
+}
+
+/**
+ * Addresses of the page-table entries read by a walk for vaddr, root first.
+ */
+int page_table_c::walk(addr_t vaddr, addr_t pte_addr[NUM_LEVELS]) {
+  int last_level = (translate(vaddr).m_page_bits == PAGE_BITS_2M) ? 2 : 1;
+
+  int num_levels = 0;
+  for (int level = NUM_LEVELS; level >= last_level; --level) {
+    addr_t index = (vaddr >> (PAGE_BITS_4K + LEVEL_BITS * (level - 1))) & ((1 << LEVEL_BITS) - 1);
+    pte_addr[num_levels++] = node(level, vaddr) + index * PTE_SIZE;
+  }
+  return num_levels;
+}
@@ -0,0 +1,56 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __PAGE_TABLE_H__
+#define __PAGE_TABLE_H__
+
+#include "atom/global.h"
+#include "tlb.h"
+
+#include <unordered_map>
+
+/// how physical frames are assigned to virtual pages (page_alloc)
+enum PAGE_ALLOC_POLICY {
+  PAGE_ALLOC_SEQUENTIAL = 0,   ///< 4K frames in first-touch order
+  PAGE_ALLOC_RANDOM,           ///< 4K frames scattered over physical memory
+  PAGE_ALLOC_HUGE,             ///< 2M frames in first-touch order
+  PAGE_ALLOC_LAST
+};
+
+/**
+ *
+ * @class page_table_c
+ *
+ * x86-64 style 4-level radix page table, built on first touch.  Data pages
+ * and page-table nodes both take frames from the allocation policy.  A walk
+ * reads one 8B entry per level: 4 for a 4K page, 3 for a 2M page (the walk
+ * stops at the page directory).
+ */
+class page_table_c {
+public:
+  static const int NUM_LEVELS = 4;
+
+  page_table_c(int policy, int phys_mem_mb, uint64_t seed);
+
+  translation_s translate(addr_t vaddr);                 ///< allocates the page on first touch
+  int walk(addr_t vaddr, addr_t pte_addr[NUM_LEVELS]);   ///< entry addresses; returns the number of levels
+
+  counter m_num_pages;        ///< data pages allocated
+  counter m_num_nodes;        ///< page-table nodes allocated
+
+private:
+  addr_t alloc_frame();                   ///< one 4K frame (physical address)
+  addr_t alloc_huge_frame();              ///< one 2M-aligned frame (physical address)
+  addr_t node(int level, addr_t vaddr);   ///< page-table node covering vaddr at level
+
+  int m_policy;
+  uint64_t m_num_frames;                  ///< 4K frames of physical memory (power of two)
+  uint64_t m_next_frame;                  ///< sequential allocation cursor
+  uint64_t m_random_mul;                  ///< random: frame = (n * mul + add) mod frames
+  uint64_t m_random_add;
+
+  std::unordered_map<addr_t, translation_s> m_pages;  ///< virtual page base -> mapping
+  std::unordered_map<addr_t, addr_t> m_nodes;        ///< (level, vaddr prefix) -> node frame
+};
+
+#endif // !__PAGE_TABLE_H__
@@ -0,0 +1,135 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class parallel_engine_c
+ *
+ * Conservative (lookahead-based) parallel simulation of the cache/memory
+ * boundary.  See parallel_engine.h for the synchronization rules.
+ */
+
+#include "parallel_engine.h"
+#include "cache.h"
+#include "memory_controller/simple_mem.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+thread_local bool tls_memory_thread = false;
+
+inline void spin_wait() { std::this_thread::yield(); }
+}
+
+parallel_engine_c::parallel_engine_c(simple_mem_c* memory, cache_c* prev, uint32_t latency)
+    : m_cache_done(0), m_memory_done(0), m_stop(false) {
+  m_memory = memory;
+  m_prev = prev;
+  m_latency = latency;
+
+  m_cache_cycle = 0;
+  m_memory_cycle = 0;
+  m_wb_deadline = 0;
+}
+
+parallel_engine_c::~parallel_engine_c() {
+  stop();
+}
+
+void parallel_engine_c::start() {
+  assert(!m_thread.joinable());
+  m_thread = std::thread(&parallel_engine_c::run_memory, this);
+}
+
+void parallel_engine_c::stop() {
+  if (!m_thread.joinable()) return;
+  m_stop.store(true, std::memory_order_release);
+  m_thread.join();
+}
+
+bool parallel_engine_c::on_memory_thread() {
+  return tls_memory_thread;
+}
+
+/**
+ * Memory thread.  Cycle d may only run once the caches have finished cycle
+ * (d - latency): any request they send later becomes ready after cycle d.
+ */
+void parallel_engine_c::run_memory() {
+  tls_memory_thread = true;
+
+  while (true) {
+    while (m_cache_done.load(std::memory_order_acquire) + m_latency <= m_memory_cycle) {
+      if (m_stop.load(std::memory_order_acquire)) return;
+      drain_to_memory();
+      spin_wait();
+    }
+    drain_to_memory();
+
+    m_memory->run_a_cycle();
+
+    m_memory_done.store(++m_memory_cycle, std::memory_order_release);
+  }
+}
+
+/**
+ * Requests arrive here later than in the serial run, so simple_mem_c::access
+ * computes the ready cycle from the wrong base; restore it from the stamp.
+ */
+void parallel_engine_c::drain_to_memory() {
+  channel_msg_s msg;
+  while (m_to_memory.front(msg)) {
+    m_memory->access(msg.m_req);
+    msg.m_req->m_rdy_cycle = msg.m_cycle + m_latency;
+    m_to_memory.pop();
+  }
+}
+
+/**
+ * Cache thread, before ticking the caches in the given cycle.  Memory must have
+ * finished the previous cycle; its fills from that cycle are delivered now,
+ * which is where the serial run (caches tick before memory) would see them.
+ */
+void parallel_engine_c::begin_cycle(counter cycle) {
+  m_cache_cycle = cycle;
+
+  while (m_memory_done.load(std::memory_order_acquire) < cycle) {
+    spin_wait();
+  }
+
+  channel_msg_s msg;
+  while (m_to_cache.front(msg) && msg.m_cycle < cycle) {
+    m_prev->fill(msg.m_req);
+    m_to_cache.pop();
+  }
+}
+
+void parallel_engine_c::end_cycle(counter cycle) {
+  m_cache_done.store(cycle + 1, std::memory_order_release);
+}
+
+void parallel_engine_c::send_to_memory(mem_req_s* req) {
+  if (req->m_type == REQ_WB) {
+    auto& vv = m_tracked_wb;
+    vv.erase(std::remove(vv.begin(), vv.end(), req), vv.end());
+    m_wb_deadline = std::max(m_wb_deadline, m_cache_cycle + m_latency);
+  }
+  m_to_memory.push(m_cache_cycle, req);
+}
+
+void parallel_engine_c::track_wb(mem_req_s* req) {
+  m_tracked_wb.push_back(req);
+}
+
+/**
+ * Memory retires a write-back in the cycle it becomes ready, so whether memory
+ * still holds one is known on the cache side without asking the memory thread.
+ */
+bool parallel_engine_c::is_wb_done() {
+  return m_tracked_wb.empty() && m_wb_deadline <= m_cache_cycle;
+}
+
+void parallel_engine_c::send_fill(mem_req_s* req) {
+  m_to_cache.push(m_memory_cycle, req);
+}
@@ -0,0 +1,84 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __PARALLEL_ENGINE_H__
+#define __PARALLEL_ENGINE_H__
+
+#include "atom/global.h"
+#include "atom/mem_req.h"
+#include "atom/channel.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// forward declaration
+class cache_c;
+class simple_mem_c;
+
+/**
+ *
+ * @class parallel_engine_c
+ *
+ * Runs main memory on its own host thread while the core and the caches keep
+ * ticking on the calling thread.  The two sides never meet at a per-cycle
+ * barrier; instead every request that crosses the boundary goes through a
+ * channel_c stamped with the sender's cycle, and each side only waits when it
+ * is about to simulate a cycle that a message still in flight could affect.
+ *
+ *  - cache -> memory: a request sent in cycle s becomes ready at s + latency,
+ *    so memory may run up to (latency - 1) cycles ahead of the caches.
+ *  - memory -> cache: a fill sent in cycle d is enqueued at the cache in
+ *    cycle d + 1, so the caches never run ahead of memory.
+ *
+ * The caches (and the core) stay on one thread because back-invalidation and
+ * the shared in-flight request list couple them with zero latency.  Results
+ * are identical to the serial run.
+ */
+class parallel_engine_c {
+public:
+  parallel_engine_c(simple_mem_c* memory, cache_c* prev, uint32_t latency);
+  ~parallel_engine_c();
+
+  void start();                          ///< spawn the memory thread
+  void stop();                           ///< stop and join the memory thread
+
+  // called on the cache thread
+  void begin_cycle(counter cycle);       ///< wait for memory and deliver fills
+  void end_cycle(counter cycle);         ///< publish cache progress
+  void send_to_memory(mem_req_s* req);   ///< replaces simple_mem_c::access
+  void track_wb(mem_req_s* req);         ///< replaces the early in_flight_wb push
+  bool is_wb_done();                     ///< no write-back pending in memory
+
+  // called on the memory thread
+  void send_fill(mem_req_s* req);        ///< replaces cache_c::fill from memory
+
+  /// returns true if the caller runs on the memory thread
+  static bool on_memory_thread();
+
+private:
+  void run_memory();                     ///< memory thread main loop
+  void drain_to_memory();                ///< hand over requests from the caches
+
+  simple_mem_c* m_memory;                ///< main memory (memory thread)
+  cache_c* m_prev;                       ///< cache that memory fills into
+  uint32_t m_latency;                    ///< memory latency (lookahead)
+
+  channel_c m_to_memory;                 ///< cache -> memory requests
+  channel_c m_to_cache;                  ///< memory -> cache fills
+
+  // progress: number of cycles each side has completed
+  alignas(64) std::atomic<counter> m_cache_done;
+  alignas(64) std::atomic<counter> m_memory_done;
+  std::atomic<bool> m_stop;
+
+  counter m_cache_cycle;                 ///< current cycle on the cache side
+  counter m_memory_cycle;                ///< current cycle on the memory side
+
+  std::vector<mem_req_s*> m_tracked_wb;  ///< write-backs not yet sent to memory
+  counter m_wb_deadline;                 ///< cycle when the last write-back retires
+
+  std::thread m_thread;
+};
+
+#endif // !__PARALLEL_ENGINE_H__
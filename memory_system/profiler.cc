@@ -0,0 +1,64 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class profiler_c
+ *
+ * Host-time profile of the simulation loop; see profiler.h.
+ */
+
+#include "profiler.h"
+
+#include <cstdio>
+
+namespace {
+const char* STAGE_NAMES[PROF_LAST] = {
+  "workload", "issue", "mmu", "wb queue", "fill queue", "out queue", "in queue", "dram", "done",
+};
+}
+
+profiler_c::profiler_c() {
+  m_enabled = false;
+  m_used = false;
+  for (int ii = 0; ii < PROF_LAST; ++ii) m_ticks[ii] = 0;
+  m_start_ticks = 0;
+  m_total_ticks = 0;
+  m_seconds = 0.0;
+}
+
+void profiler_c::enable() {
+  m_enabled = true;
+  m_used = true;
+  m_start_ticks = now();
+  m_start_time = std::chrono::steady_clock::now();
+}
+
+void profiler_c::stop() {
+  if (!m_enabled) return;
+  m_enabled = false;
+  m_total_ticks = now() - m_start_ticks;
+  m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start_time).count();
+}
+
+void profiler_c::print() const {
+  if (!m_used) return;
+
+  double seconds = m_seconds;
+  uint64_t total = m_total_ticks;
+  double secs_per_tick = total ? seconds / total : 0.0;
+
+  printf("------------------------------\n");
+  printf("Host Time Profile\n");
+  printf("------------------------------\n");
+  printf("total: %.3f s\n", seconds);
+
+  uint64_t staged = 0;
+  for (int ii = 0; ii < PROF_LAST; ++ii) {
+    staged += m_ticks[ii];
+    printf("%s: %.3f s (%.1f%%)\n", STAGE_NAMES[ii], m_ticks[ii] * secs_per_tick,
+           total ? 100.0 * m_ticks[ii] / total : 0.0);
+  }
+  uint64_t other = (total > staged) ? total - staged : 0;
+  printf("other: %.3f s (%.1f%%)\n", other * secs_per_tick, total ? 100.0 * other / total : 0.0);
+}
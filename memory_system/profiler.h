@@ -0,0 +1,90 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// stages of the simulation loop timed by profiler_c
+enum PROFILE_STAGE {
+  PROF_WORKLOAD = 0,   ///< reading (parsing) or generating the next record
+  PROF_ISSUE,          ///< new core requests into the hierarchy (incl. TLB lookups)
+  PROF_MMU,            ///< releasing translated requests
+  PROF_WB_QUEUE,       ///< caches: write-backs to the next level
+  PROF_FILL_QUEUE,     ///< caches: fills and incoming write-backs
+  PROF_OUT_QUEUE,      ///< caches: misses to the next level
+  PROF_IN_QUEUE,       ///< caches: lookups
+  PROF_DRAM,           ///< main memory (parallel_sim: waiting for the memory thread)
+  PROF_DONE,           ///< retiring finished requests
+  PROF_LAST
+};
+
+/**
+ *
+ * @class profiler_c
+ *
+ * Host-time profile of the simulation loop (config: profile = 1).  Each stage
+ * accumulates time stamp counter ticks, which print() converts to seconds by
+ * the tick rate over the whole run; time outside every stage is reported as
+ * "other".  stop() ends the run, so printing the stats is not counted.
+ * Only the simulation thread records stages.
+ */
+class profiler_c {
+public:
+  profiler_c();
+
+  void enable();                      ///< start the clock
+  void stop();                        ///< end of the simulation: stop the clock
+  bool is_enabled() const { return m_enabled; }
+  void add(int stage, uint64_t ticks) { m_ticks[stage] += ticks; }
+  void print() const;                 ///< per-stage breakdown (no-op if never enabled)
+
+  /// cheap monotonic tick count (time stamp counter if there is one)
+  static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+private:
+  bool m_enabled;                     ///< the clock is running
+  bool m_used;                        ///< enable() was called
+  uint64_t m_ticks[PROF_LAST];        ///< ticks spent in each stage
+  uint64_t m_start_ticks;             ///< now() at enable()
+  uint64_t m_total_ticks;             ///< enable() to stop()
+  double m_seconds;                   ///< wall time from enable() to stop()
+  std::chrono::steady_clock::time_point m_start_time;  ///< wall time at enable()
+};
+
+/**
+ *
+ * @class profile_scope_c
+ *
+ * Adds the time until the end of the scope to one stage; a single branch
+ * when profiling is off.
+ */
+class profile_scope_c {
+public:
+  profile_scope_c(profiler_c& profiler, int stage) : m_profiler(profiler), m_stage(stage) {
+    m_start = profiler.is_enabled() ? profiler_c::now() : 0;
+  }
+  ~profile_scope_c() {
+    if (m_profiler.is_enabled()) m_profiler.add(m_stage, profiler_c::now() - m_start);
+  }
+
+private:
+  profiler_c& m_profiler;
+  int m_stage;
+  uint64_t m_start;
+};
+
+#endif // !__PROFILER_H__
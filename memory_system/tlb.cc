@@ -0,0 +1,110 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class tlb_c
+ *
+ * Translation lookaside buffer; see tlb.h.
+ */
+
+#include "tlb.h"
+
+#include <cassert>
+#include <iostream>
+
+tlb_c::tlb_c(std::string name, int num_entries, int assoc, int latency) {
+  assert(num_entries > 0 && assoc > 0 && num_entries % assoc == 0);
+  m_name = name;
+  m_num_sets = num_entries / assoc;
+  m_assoc = assoc;
+  m_latency = latency;
+
+  entry_s empty = {false, 0, 0, 0, 0};
+  m_entries.assign(num_entries, empty);
+  m_stamp = 0;
+  m_has_page_bits[0] = false;
+  m_has_page_bits[1] = false;
+
+  m_num_accesses = 0;
+  m_num_hits = 0;
+  m_num_misses = 0;
+}
+
+tlb_c::entry_s* tlb_c::find(addr_t vaddr, int page_bits) {
+  addr_t vpn = vaddr >> page_bits;
+  entry_s* set = &m_entries[(vpn % m_num_sets) * m_assoc];
+  for (int ii = 0; ii < m_assoc; ++ii) {
+    if (set[ii].m_valid && set[ii].m_page_bits == page_bits && set[ii].m_vpn == vpn) {
+      return &set[ii];
+    }
+  }
+  return nullptr;
+}
+
+bool tlb_c::lookup(addr_t vaddr, translation_s& translation) {
+  ++m_num_accesses;
+
+  entry_s* entry = nullptr;
+  if (m_has_page_bits[0]) entry = find(vaddr, PAGE_BITS_4K);
+  if (!entry && m_has_page_bits[1]) entry = find(vaddr, PAGE_BITS_2M);
+
+  if (!entry) {
+    ++m_num_misses;
+    return false;
+  }
+
+  ++m_num_hits;
+  entry->m_last_use = ++m_stamp;
+  translation.m_vbase = entry->m_vpn << entry->m_page_bits;
+  translation.m_pbase = entry->m_pbase;
+  translation.m_page_bits = entry->m_page_bits;
+  return true;
+}
+
+/**
+ * Install a translation, replacing an invalid or the LRU entry of its set.
+ */
+void tlb_c::insert(const translation_s& translation) {
+  int page_bits = translation.m_page_bits;
+  assert(page_bits == PAGE_BITS_4K || page_bits == PAGE_BITS_2M);
+  m_has_page_bits[page_bits == PAGE_BITS_2M] = true;
+
+  entry_s* entry = find(translation.m_vbase, page_bits);
+  if (!entry) {
+    addr_t vpn = translation.m_vbase >> page_bits;
+    entry_s* set = &m_entries[(vpn % m_num_sets) * m_assoc];
+    entry = &set[0];
+    for (int ii = 0; ii < m_assoc && entry->m_valid; ++ii) {
+      if (!set[ii].m_valid || set[ii].m_last_use < entry->m_last_use) entry = &set[ii];
+    }
+  }
+
+  entry->m_valid = true;
+  entry->m_page_bits = page_bits;
+  entry->m_vpn = translation.m_vbase >> page_bits;
+  entry->m_pbase = translation.m_pbase;
+  entry->m_last_use = ++m_stamp;
+}
+
+void tlb_c::print_stats() {
+  std::cout << "------------------------------" << "\n";
+  std::cout << m_name << " Hit Rate: " << (m_num_accesses ? (double)m_num_hits / m_num_accesses * 100 : 0.0) << " % \n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "number of accesses: " << m_num_accesses << "\n";
+  std::cout << "number of hits: " << m_num_hits << "\n";
+  std::cout << "number of misses: " << m_num_misses << "\n";
+}
+
+void tlb_c::reset_stats() {
+  m_num_accesses = 0;
+  m_num_hits = 0;
+  m_num_misses = 0;
+}
+
+void tlb_c::register_stats(stats_registry_c& stats, const std::string& prefix) {
+  stats.add_counter(prefix + ".accesses", &m_num_accesses);
+  stats.add_counter(prefix + ".hits", &m_num_hits);
+  stats.add_counter(prefix + ".misses", &m_num_misses);
+  stats.add_ratio(prefix + ".hit_rate", &m_num_hits, &m_num_accesses);
+}
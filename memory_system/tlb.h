@@ -0,0 +1,75 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __TLB_H__
+#define __TLB_H__
+
+#include "atom/global.h"
+#include "./cache_base/stats.h"
+
+#include <string>
+#include <vector>
+
+/// page sizes (log2)
+const int PAGE_BITS_4K = 12;
+const int PAGE_BITS_2M = 21;
+
+/// one virtual-to-physical page mapping
+struct translation_s {
+  addr_t m_vbase;      ///< virtual page base
+  addr_t m_pbase;      ///< physical page base
+  int m_page_bits;     ///< page size (PAGE_BITS_4K or PAGE_BITS_2M)
+
+  addr_t translate(addr_t vaddr) const {
+    return m_pbase | (vaddr & (((addr_t)1 << m_page_bits) - 1));
+  }
+};
+
+/**
+ *
+ * @class tlb_c
+ *
+ * Set-associative LRU TLB.  4K and 2M pages share the entries: a lookup probes
+ * the set of each page size that the TLB has seen, using the virtual page
+ * number of that size as the index.
+ */
+class tlb_c {
+public:
+  tlb_c(std::string name, int num_entries, int assoc, int latency);
+
+  bool lookup(addr_t vaddr, translation_s& translation);  ///< updates LRU and stats
+  void insert(const translation_s& translation);
+
+  int get_latency() const { return m_latency; }
+
+  void print_stats();
+  void reset_stats();
+  void register_stats(stats_registry_c& stats, const std::string& prefix);
+
+private:
+  struct entry_s {
+    bool m_valid;
+    int m_page_bits;
+    addr_t m_vpn;        ///< virtual page number (of m_page_bits)
+    addr_t m_pbase;
+    counter m_last_use;  ///< LRU stamp
+  };
+
+  entry_s* find(addr_t vaddr, int page_bits);
+
+  std::string m_name;
+  int m_num_sets;
+  int m_assoc;
+  int m_latency;           ///< extra cycles on a hit (0: overlapped with the L1 access)
+
+  std::vector<entry_s> m_entries;  ///< set-major: set * assoc + way
+  counter m_stamp;                 ///< LRU clock
+  bool m_has_page_bits[2];         ///< 4K / 2M entries were inserted
+
+  // statistics
+  counter m_num_accesses;
+  counter m_num_hits;
+  counter m_num_misses;
+};
+
+#endif // !__TLB_H__
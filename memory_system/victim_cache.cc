@@ -0,0 +1,134 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class victim_cache_c
+ *
+ * Fully-associative victim buffer attached to an L1 cache (see victim_cache.h).
+ * It only keeps the tags and dirty bits; the owning cache_c decides what to do
+ * with the lines it returns or displaces.
+ */
+
+#include "victim_cache.h"
+
+#include <cassert>
+#include <iostream>
+
+victim_cache_c::victim_cache_c(std::string name, int num_entries, int line_size, int latency) {
+  assert(num_entries > 0);
+
+  m_name = name;
+  m_num_entries = num_entries;
+  m_line_size = line_size;
+  m_latency = latency;
+
+  m_num_probes = 0;
+  m_num_hits = 0;
+  m_num_inserts = 0;
+  m_num_evictions = 0;
+  m_num_evictions_dirty = 0;
+}
+
+std::list<victim_entry_s>::iterator victim_cache_c::find(addr_t address) {
+  addr_t addr = line_addr(address);
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->m_addr == addr) return it;
+  }
+  return m_entries.end();
+}
+
+/**
+ * Look up the line on an L1 miss.
+ * @param dirty - set to the dirty bit of the line on a hit
+ * @return "true" on a hit; the line leaves the victim cache (it moves to the L1).
+ */
+bool victim_cache_c::probe(addr_t address, bool& dirty) {
+  ++m_num_probes;
+
+  auto it = find(address);
+  if (it == m_entries.end()) {
+    return false;
+  }
+
+  ++m_num_hits;
+  dirty = it->m_dirty;
+  m_entries.erase(it);
+  return true;
+}
+
+/**
+ * Insert a line evicted from the L1 at the MRU position.  If the line is
+ * already here, the dirty bits are merged.
+ * @param evicted - the LRU line displaced to make room
+ * @return "true" if a line was displaced; "false" otherwise.
+ */
+bool victim_cache_c::insert(addr_t address, bool dirty, victim_entry_s& evicted) {
+  ++m_num_inserts;
+
+  auto it = find(address);
+  if (it != m_entries.end()) {
+    dirty = dirty || it->m_dirty;
+    m_entries.erase(it);
+  }
+  m_entries.push_front(victim_entry_s{line_addr(address), dirty});
+
+  if ((int)m_entries.size() <= m_num_entries) {
+    return false;
+  }
+
+  evicted = m_entries.back();
+  m_entries.pop_back();
+
+  ++m_num_evictions;
+  if (evicted.m_dirty) ++m_num_evictions_dirty;
+  return true;
+}
+
+/**
+ * Drop the line (no statistics are updated).
+ */
+bool victim_cache_c::invalidate(addr_t address, bool& dirty) {
+  auto it = find(address);
+  if (it == m_entries.end()) {
+    return false;
+  }
+
+  dirty = it->m_dirty;
+  m_entries.erase(it);
+  return true;
+}
+
+void victim_cache_c::count_lines(std::vector<addr_t>& lines) {
+  for (const victim_entry_s& entry : m_entries) {
+    lines.push_back(entry.m_addr);
+  }
+}
+
+void victim_cache_c::print_stats() {
+  std::cout << "------------------------------" << "\n";
+  std::cout << m_name << " Hit Rate: " << (m_num_probes ? (double)m_num_hits / m_num_probes * 100 : 0.0) << " % \n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "number of probes: " << m_num_probes << "\n";
+  std::cout << "number of hits: " << m_num_hits << "\n";
+  std::cout << "number of inserts: " << m_num_inserts << "\n";
+  std::cout << "number of evictions: " << m_num_evictions << "\n";
+  std::cout << "number of dirty evictions: " << m_num_evictions_dirty << "\n";
+}
+
+void victim_cache_c::reset_stats() {
+  m_num_probes = 0;
+  m_num_hits = 0;
+  m_num_inserts = 0;
+  m_num_evictions = 0;
+  m_num_evictions_dirty = 0;
+}
+
+void victim_cache_c::register_stats(stats_registry_c& stats, const std::string& prefix) {
+  stats.add_counter(prefix + ".probes", &m_num_probes);
+  stats.add_counter(prefix + ".hits", &m_num_hits);
+  stats.add_counter(prefix + ".inserts", &m_num_inserts);
+  stats.add_counter(prefix + ".evictions", &m_num_evictions);
+  stats.add_counter(prefix + ".dirty_evictions", &m_num_evictions_dirty);
+  stats.add_ratio(prefix + ".hit_rate", &m_num_hits, &m_num_probes);
+}
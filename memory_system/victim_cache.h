@@ -0,0 +1,66 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __VICTIM_CACHE_H__
+#define __VICTIM_CACHE_H__
+
+#include "atom/global.h"
+#include "./cache_base/cache_base.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+/// one line held by the victim cache
+struct victim_entry_s {
+  addr_t m_addr;     ///< line-aligned address
+  bool   m_dirty;    ///< dirty bit
+};
+
+/**
+ *
+ * @class victim_cache_c
+ *
+ * Small fully-associative buffer (LRU) next to an L1 cache.  It holds the lines
+ * evicted from the L1 and is probed on L1 misses; a hit moves the line back
+ * into the L1 (swap), so a line lives in at most one of the two.
+ */
+class victim_cache_c {
+public:
+  victim_cache_c(std::string name, int num_entries, int line_size, int latency);
+
+  bool probe(addr_t address, bool& dirty);   ///< on a hit, remove the line (swap-on-hit)
+  bool insert(addr_t address, bool dirty, victim_entry_s& evicted);  ///< true if a line is displaced
+  bool invalidate(addr_t address, bool& dirty);  ///< drop the line; true if present
+  bool contains(addr_t address) { return find(address) != m_entries.end(); }  ///< no stats, no LRU update
+
+  int get_latency() const { return m_latency; }
+  int get_num_entries() const { return m_num_entries; }
+  void count_lines(std::vector<addr_t>& lines);  ///< append the address of every line
+
+  void print_stats();
+  void reset_stats();
+  void register_stats(stats_registry_c& stats, const std::string& prefix);
+
+private:
+  addr_t line_addr(addr_t address) const { return address / m_line_size * m_line_size; }
+  std::list<victim_entry_s>::iterator find(addr_t address);
+
+  std::string m_name;          ///< victim cache name
+  int m_num_entries;           ///< capacity in lines
+  int m_line_size;             ///< line size (same as the L1)
+  int m_latency;               ///< extra cycles to return data on a hit
+
+  // MRU: front
+  // LRU: back
+  std::list<victim_entry_s> m_entries;
+
+  // statistics
+  counter m_num_probes;        ///< # of L1 misses that probed the victim cache
+  counter m_num_hits;          ///< # of probes that hit (line swapped back)
+  counter m_num_inserts;       ///< # of L1 victims inserted
+  counter m_num_evictions;     ///< # of lines displaced to the next level
+  counter m_num_evictions_dirty; ///< # of those that were dirty
+};
+
+#endif // !__VICTIM_CACHE_H__
@@ -0,0 +1,110 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+/**
+ *
+ * @class write_buffer_c
+ *
+ * Coalescing write buffer on the write-back path of a cache (see
+ * write_buffer.h).
+ */
+
+#include "write_buffer.h"
+
+#include <cassert>
+#include <iostream>
+
+write_buffer_c::write_buffer_c(std::string name, int num_entries, int line_size) {
+  assert(num_entries > 0);
+
+  m_name = name;
+  m_num_entries = num_entries;
+  m_line_size = line_size;
+
+  m_num_inserts = 0;
+  m_num_coalesced = 0;
+  m_num_drains = 0;
+  m_num_full_stalls = 0;
+  m_num_read_hits = 0;
+  m_num_cycles = 0;
+  m_occupancy_sum = 0;
+  m_max_occupancy = 0;
+}
+
+mem_req_s* write_buffer_c::find(addr_t address) {
+  addr_t addr = line_addr(address);
+  for (mem_req_s* req : m_entries) {
+    if (line_addr(req->m_addr) == addr) return req;
+  }
+  return nullptr;
+}
+
+void write_buffer_c::push(mem_req_s* req) {
+  assert(!full());
+  ++m_num_inserts;
+  m_entries.push_back(req);
+  if (m_entries.size() > m_max_occupancy) {
+    m_max_occupancy = m_entries.size();
+  }
+}
+
+/**
+ * Merge a write-back into the buffered one for the same line; the merged line
+ * is dirty if either was (a clean victim for an exclusive next level may meet
+ * a dirty one).
+ */
+void write_buffer_c::coalesce(mem_req_s* pending, mem_req_s* req) {
+  ++m_num_inserts;
+  ++m_num_coalesced;
+  pending->m_dirty = pending->m_dirty || req->m_dirty;
+}
+
+mem_req_s* write_buffer_c::pop(bool forced) {
+  assert(!empty());
+  mem_req_s* req = m_entries.front();
+  m_entries.pop_front();
+
+  ++m_num_drains;
+  if (forced) ++m_num_full_stalls;
+  return req;
+}
+
+void write_buffer_c::tick() {
+  ++m_num_cycles;
+  m_occupancy_sum += m_entries.size();
+}
+
+void write_buffer_c::print_stats() {
+  std::cout << "------------------------------" << "\n";
+  std::cout << m_name << " Coalescing Rate: " << (m_num_inserts ? (double)m_num_coalesced / m_num_inserts * 100 : 0.0) << " % \n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "number of inserts: " << m_num_inserts << "\n";
+  std::cout << "number of coalesced writebacks: " << m_num_coalesced << "\n";
+  std::cout << "number of drains: " << m_num_drains << "\n";
+  std::cout << "number of full stalls: " << m_num_full_stalls << "\n";
+  std::cout << "number of read hits: " << m_num_read_hits << "\n";
+  std::cout << "average occupancy: " << (m_num_cycles ? (double)m_occupancy_sum / m_num_cycles : 0.0) << "\n";
+  std::cout << "max occupancy: " << m_max_occupancy << "\n";
+}
+
+void write_buffer_c::reset_stats() {
+  m_num_inserts = 0;
+  m_num_coalesced = 0;
+  m_num_drains = 0;
+  m_num_full_stalls = 0;
+  m_num_read_hits = 0;
+  m_num_cycles = 0;
+  m_occupancy_sum = 0;
+  m_max_occupancy = m_entries.size();
+}
+
+void write_buffer_c::register_stats(stats_registry_c& stats, const std::string& prefix) {
+  stats.add_counter(prefix + ".inserts", &m_num_inserts);
+  stats.add_counter(prefix + ".coalesced", &m_num_coalesced);
+  stats.add_counter(prefix + ".drains", &m_num_drains);
+  stats.add_counter(prefix + ".full_stalls", &m_num_full_stalls);
+  stats.add_counter(prefix + ".read_hits", &m_num_read_hits);
+  stats.add_ratio(prefix + ".coalescing_rate", &m_num_coalesced, &m_num_inserts);
+  stats.add_ratio(prefix + ".avg_occupancy", &m_occupancy_sum, &m_num_cycles);
+  stats.add_counter(prefix + ".max_occupancy", &m_max_occupancy);
+}
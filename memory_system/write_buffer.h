@@ -0,0 +1,61 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __WRITE_BUFFER_H__
+#define __WRITE_BUFFER_H__
+
+#include "atom/global.h"
+#include "atom/mem_req.h"
+#include "./cache_base/stats.h"
+
+#include <list>
+#include <string>
+
+/**
+ *
+ * @class write_buffer_c
+ *
+ * Bounded FIFO of write-back requests between a cache and the next level.
+ * A write-back to a line that is already buffered is merged into the pending
+ * request (coalescing); misses may read the buffered data.  The owning cache_c
+ * decides when entries drain (see cache_c::process_wb_queue).
+ */
+class write_buffer_c {
+public:
+  write_buffer_c(std::string name, int num_entries, int line_size);
+
+  mem_req_s* find(addr_t address);    ///< buffered write-back to the same line, or nullptr
+  bool full() const { return (int)m_entries.size() >= m_num_entries; }
+  bool empty() const { return m_entries.empty(); }
+
+  void push(mem_req_s* req);          ///< buffer a new write-back (must not be full)
+  void coalesce(mem_req_s* pending, mem_req_s* req);  ///< merge req into pending
+  mem_req_s* pop(bool forced);        ///< oldest entry; forced: the buffer was full
+  void count_read_hit() { ++m_num_read_hits; }
+
+  void tick();                        ///< sample the occupancy once per cycle
+  void print_stats();
+  void reset_stats();
+  void register_stats(stats_registry_c& stats, const std::string& prefix);
+
+private:
+  addr_t line_addr(addr_t address) const { return address / m_line_size * m_line_size; }
+
+  std::string m_name;          ///< write buffer name
+  int m_num_entries;           ///< capacity in lines
+  int m_line_size;             ///< line size (same as the cache)
+
+  std::list<mem_req_s*> m_entries;  ///< oldest first
+
+  // statistics
+  counter m_num_inserts;       ///< # of write-backs offered to the buffer
+  counter m_num_coalesced;     ///< # of those merged into a buffered line
+  counter m_num_drains;        ///< # of entries sent to the next level
+  counter m_num_full_stalls;   ///< # of write-backs that found the buffer full
+  counter m_num_read_hits;     ///< # of misses served from the buffer
+  counter m_num_cycles;        ///< # of sampled cycles
+  counter m_occupancy_sum;     ///< sum of the per-cycle occupancy
+  counter m_max_occupancy;     ///< peak occupancy
+};
+
+#endif // !__WRITE_BUFFER_H__